@@ -3,18 +3,30 @@
 #include <Core/CanvasMaterial.h>
 #include <Core/BackBufferCopy.h>
 #include <Core/Sprite.h>
+#include <Core/SpriteBatch.h>
+#include <Core/SpriteInstancer.h>
+#include <Core/TextureAtlas.h>
+#include <Core/CompileQueue.h>
+#include <Core/GLState.h>
+#include <Core/FrameStats.h>
+#include <Core/GPUProfiler.h>
 #include <UI/UIHelper.h>
 
 
 #include <utility>
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 #include <fstream>
 #include <string.h>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <imgui/imgui.h>
 #include <pugixml/src/pugixml.hpp>
 #include <ghc/filesystem.hpp>
 
+#define PROJECT_SETTINGS_FILE ".gdshaders" // plugin settings that are stored per project
+
 
 static const GLenum fboBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3, GL_COLOR_ATTACHMENT4, GL_COLOR_ATTACHMENT5, GL_COLOR_ATTACHMENT6, GL_COLOR_ATTACHMENT7, GL_COLOR_ATTACHMENT8, GL_COLOR_ATTACHMENT9, GL_COLOR_ATTACHMENT10, GL_COLOR_ATTACHMENT11, GL_COLOR_ATTACHMENT12, GL_COLOR_ATTACHMENT13, GL_COLOR_ATTACHMENT14, GL_COLOR_ATTACHMENT15 };
 
@@ -120,6 +132,9 @@ namespace gd
 		m_createSpritePopup = false;
 		m_clearColor = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
 		m_fbo = 0;
+		m_ownsPipeline = true;
+		m_profilerOpened = false;
+		m_incrementalCompile = true;
 		m_lastSize = glm::vec2(1, 1);
 		ShaderPathsUpdated = false;
 		m_varManagerOpened = false;
@@ -127,11 +142,20 @@ namespace gd
 		m_lastErrorCheck = 0.0f;
 		m_buildLangDefinition();
 
+		// let the driver compile & link on its own threads
+		if (GLEW_KHR_parallel_shader_compile)
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+
 		return true;
 	}
 	void GodotShaders::OnEvent(void* e) { }
 	void GodotShaders::Update(float delta)
 	{
+		// finish the shaders that were compiled in the background
+		for (auto& item : m_items)
+			if (item->Type == PipelineItemType::CanvasMaterial)
+				((pipe::CanvasMaterial*)item)->Update();
+
 		if (GetTime() - m_lastErrorCheck > 0.75f) {
 			ClearMessageGroup(Messages, "[GodotShaders]");
 			if (m_items.size() > 0) {
@@ -148,6 +172,15 @@ namespace gd
 		}
 
 
+		// ##### GPU PROFILER #####
+		GPUProfiler::Instance().Enabled = m_profilerOpened; // queries are only issued while someone looks at them
+		if (m_profilerOpened)
+			m_showProfiler();
+
+		// ##### FRAME STATISTICS #####
+		if (FrameStats::Instance().ShowOverlay)
+			FrameStats::Instance().ShowOverlayWindow();
+
 		// ##### UNIFORM MANAGER POPUP #####
 		if (m_varManagerOpened) {
 			ImGui::OpenPopup("Uniforms##gshader_uniforms");
@@ -207,11 +240,16 @@ namespace gd
 			ImGui::EndPopup();
 		}
 	}
-	void GodotShaders::Destroy() { }
+	void GodotShaders::Destroy()
+	{
+		CompileQueue::Instance().Shutdown();
+	}
 
 	void GodotShaders::BeginRender()
 	{
-		ResourceManager::Instance().CopiedScreenTexture = false;
+		GPUProfiler::Instance().BeginFrame();
+		FrameStats::Instance().BeginFrame();
+		TextureAtlas::Instance().NewFrame();
 
 		GetViewportSize(m_rtSize.x, m_rtSize.y);
 		if (m_lastSize != m_rtSize) {
@@ -238,6 +276,16 @@ namespace gd
 			}
 		}
 
+		// shaders that pass SCREEN_TEXTURE to their own functions can't have their UVs scaled -> no pooling
+		bool exactScreen = false;
+		for (auto item : m_items)
+			if (item->Type == PipelineItemType::CanvasMaterial && ((pipe::CanvasMaterial*)item)->NeedsExactScreenTexture())
+				exactScreen = true;
+		ResourceManager::Instance().SetExactScreenSize(exactScreen);
+
+		// assign the SCREEN_TEXTURE snapshots for this frame
+		m_scheduleSnapshots();
+
 		// bind fbo and buffers
 		glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
 		glDrawBuffers(1, fboBuffers);
@@ -250,20 +298,111 @@ namespace gd
 
 		// update viewport value
 		glViewport(0, 0, m_rtSize.x, m_rtSize.y);
+
+		// SHADERed's passes change the GL state between our items -> the cached state can't be trusted across them
+		m_ownsPipeline = true;
+		int pipeCount = GetPipelineItemCount(PipelineManager);
+		for (int i = 0; i < pipeCount; i++)
+			if (GetPipelineItemType(PipelineManager, i) != ed::plugin::PipelineItemType::PluginItem)
+				m_ownsPipeline = false;
+
+		// reorder & merge the materials, only when nothing else is drawn in between
+		if (m_ownsPipeline)
+			m_optimizer.Build(m_items);
+		else
+			m_optimizer.Clear();
+
+		// everything from here on goes through GLState
+		GLState& state = GLState::Instance();
+		state.Begin();
+		state.Enable(GL_CULL_FACE, false);
+		state.Enable(GL_DEPTH_TEST, false);
 	}
 	void GodotShaders::EndRender()
 	{
+		// leave the state the way SHADERed expects it
+		GLState& state = GLState::Instance();
+		state.Enable(GL_DEPTH_TEST, true);
+		state.Enable(GL_CULL_FACE, true);
+		state.BindVertexArray(0);
+		state.End();
+
+		GPUProfiler::Instance().EndFrame();
+	}
+	void GodotShaders::m_scheduleSnapshots()
+	{
+		ResourceManager& res = ResourceManager::Instance();
+		res.InvalidateSnapshot(0);
+		res.ReleaseSnapshots();
+
+		// which BackBufferCopy each material reads & the last material that reads each BackBufferCopy
+		std::unordered_map<std::string, pipe::BackBufferCopy*> writers;
+		std::unordered_map<pipe::CanvasMaterial*, pipe::BackBufferCopy*> source;
+		std::unordered_map<pipe::BackBufferCopy*, pipe::CanvasMaterial*> lastReader;
+		for (PipelineItem* item : m_items) {
+			if (item->Type == PipelineItemType::BackBufferCopy) {
+				pipe::BackBufferCopy* copy = (pipe::BackBufferCopy*)item;
+				copy->SnapshotSlot = -1;
+				if (copy->Snapshot[0] != 0)
+					writers[copy->Snapshot] = copy;
+			} else if (item->Type == PipelineItemType::CanvasMaterial) {
+				pipe::CanvasMaterial* mat = (pipe::CanvasMaterial*)item;
+				mat->ScreenSnapshotSlot = 0;
+				if (mat->ScreenSnapshot[0] == 0 || !mat->IsScreenTextureUsed())
+					continue;
+
+				auto writer = writers.find(mat->ScreenSnapshot);
+				if (writer != writers.end()) {
+					source[mat] = writer->second;
+					lastReader[writer->second] = mat;
+				}
+			}
+		}
+
+		// a snapshot is only copied if something reads it & its slot is recycled after the last read
+		for (PipelineItem* item : m_items) {
+			if (item->Type == PipelineItemType::BackBufferCopy) {
+				pipe::BackBufferCopy* copy = (pipe::BackBufferCopy*)item;
+				if (lastReader.count(copy))
+					copy->SnapshotSlot = res.AcquireSnapshot();
+			} else if (item->Type == PipelineItemType::CanvasMaterial) {
+				pipe::CanvasMaterial* mat = (pipe::CanvasMaterial*)item;
+				auto writer = source.find(mat);
+				if (writer == source.end())
+					continue;
+
+				mat->ScreenSnapshotSlot = writer->second->SnapshotSlot;
+				if (lastReader[writer->second] == mat)
+					res.ReleaseSnapshot(writer->second->SnapshotSlot);
+			}
+		}
+	}
+	std::vector<std::string> GodotShaders::GetSnapshotNames()
+	{
+		std::vector<std::string> ret;
+		for (PipelineItem* item : m_items) {
+			if (item->Type != PipelineItemType::BackBufferCopy)
+				continue;
+
+			pipe::BackBufferCopy* copy = (pipe::BackBufferCopy*)item;
+			if (copy->Snapshot[0] != 0 && std::count(ret.begin(), ret.end(), copy->Snapshot) == 0)
+				ret.push_back(copy->Snapshot);
+		}
+		return ret;
 	}
 
 	void GodotShaders::BeginProjectLoading()
 	{
 		m_items.clear();
+		TextureAtlas::Instance().Clear();
 		m_loadTextures.clear();
 		m_loadSizes.clear();
 		m_loadUniformTextures.clear();
 	}
 	void GodotShaders::EndProjectLoading()
 	{
+		m_loadProjectSettings();
+
 		for (auto& k : m_loadTextures)
 			k.first->SetTexture(k.second);
 		for (auto& k : m_loadSizes)
@@ -284,13 +423,48 @@ namespace gd
 		}
 
 
+		auto loadStart = std::chrono::high_resolution_clock::now();
+
+		std::vector<pipe::CanvasMaterial*> materials;
+		std::vector<std::string> paths;
 		for (auto& owner : m_items) {
 			if (owner->Type == PipelineItemType::CanvasMaterial) {
 				pipe::CanvasMaterial* canv = (pipe::CanvasMaterial*)owner;
 				canv->SetViewportSize(m_rtSize.x, m_rtSize.y);
-				canv->Compile();
+				materials.push_back(canv);
+				paths.push_back(canv->GetShaderFilePath());
 			}
 		}
+
+		// prepare: read all shader files at the same time
+		std::vector<std::string> sources(materials.size());
+		std::vector<std::shared_ptr<CompileQueue::Job>> readJobs;
+		for (size_t i = 0; i < materials.size(); i++)
+			readJobs.push_back(CompileQueue::Instance().Submit([&sources, &paths, i]() {
+				sources[i] = pipe::CanvasMaterial::LoadShaderFile(paths[i]);
+			}));
+		for (auto& job : readJobs)
+			CompileQueue::Instance().Wait(job);
+
+		auto readEnd = std::chrono::high_resolution_clock::now();
+
+		// prepare: transcompile everything in the background
+		for (size_t i = 0; i < materials.size(); i++)
+			materials[i]->CompileFromSource(sources[i].c_str(), sources[i].size());
+
+		// commit: GL objects are created on this thread as the transcompile jobs finish
+		for (auto& canv : materials)
+			canv->WaitForCompile();
+
+		auto loadEnd = std::chrono::high_resolution_clock::now();
+
+		if (materials.size() > 0) {
+			auto toMs = [](std::chrono::high_resolution_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+			char report[256];
+			snprintf(report, 256, "[GodotShaders] Loaded %d materials in %.2fms (file reads: %.2fms, transcompile & GL: %.2fms, %d worker threads)",
+				(int)materials.size(), toMs(loadEnd - loadStart), toMs(readEnd - loadStart), toMs(loadEnd - readEnd), CompileQueue::Instance().GetWorkerCount());
+			Log(report, false, nullptr, -1);
+		}
 	}
 	void GodotShaders::BeginProjectSaving()
 	{
@@ -298,7 +472,42 @@ namespace gd
 	}
 	void GodotShaders::EndProjectSaving()
 	{
+		m_saveProjectSettings();
+	}
+	void GodotShaders::m_loadProjectSettings()
+	{
+		ResourceManager& res = ResourceManager::Instance();
+		ScreenTextureFormat format = ScreenTextureFormat::RGBA8;
+		m_optimizer.Enabled = false;
+
+		const char* projectDir = GetProjectDirectory(Project);
+		pugi::xml_document doc;
+		if (projectDir != nullptr && doc.load_file((std::string(projectDir) + "/" PROJECT_SETTINGS_FILE).c_str())) {
+			int value = doc.child("settings").child("screen_format").text().as_int(0);
+			if (value >= 0 && value <= (int)ScreenTextureFormat::RGBA16F)
+				format = (ScreenTextureFormat)value;
+			m_optimizer.Enabled = doc.child("settings").child("optimize_pipeline").text().as_bool(false);
+		}
+
+		res.SetScreenTextureFormat(format);
+	}
+	void GodotShaders::m_saveProjectSettings()
+	{
+		const char* projectDir = GetProjectDirectory(Project);
+		if (projectDir == nullptr)
+			return;
 
+		// don't create the file for projects that only use the defaults
+		std::string path = std::string(projectDir) + "/" PROJECT_SETTINGS_FILE;
+		ScreenTextureFormat format = ResourceManager::Instance().GetScreenTextureFormat();
+		if (format == ScreenTextureFormat::RGBA8 && !m_optimizer.Enabled && !ghc::filesystem::exists(path))
+			return;
+
+		pugi::xml_document doc;
+		pugi::xml_node settings = doc.append_child("settings");
+		settings.append_child("screen_format").text().set((int)format);
+		settings.append_child("optimize_pipeline").text().set(m_optimizer.Enabled);
+		doc.save_file(path.c_str());
 	}
 	void GodotShaders::CopyFilesOnSave(const char* dir)
 	{
@@ -429,6 +638,8 @@ namespace gd
 			((pipe::CanvasMaterial*)item)->ShowProperties();
 		else if (item->Type == PipelineItemType::Sprite)
 			((pipe::Sprite*)item)->ShowProperties();
+		else if (item->Type == PipelineItemType::BackBufferCopy)
+			((pipe::BackBufferCopy*)item)->ShowProperties();
 	}
 	bool GodotShaders::IsPipelineItemPickable(const char* type) { return false; }
 	bool GodotShaders::HasPipelineItemShaders(const char* type)
@@ -556,27 +767,122 @@ namespace gd
 	void GodotShaders::ExecutePipelineItem(const char* type, void* data, void* children, int count)
 	{
 		PipelineItem* idata = (PipelineItem*)data;
+		GLState& state = GLState::Instance();
+		if (!m_ownsPipeline)
+			state.Invalidate();
+
+		GPUProfiler::Instance().Begin(idata->Name);
+		FrameStats::Instance().Add(FrameCounter::PipelineItems);
+
 		if (idata->Type == PipelineItemType::CanvasMaterial)
 		{
-			glDisable(GL_CULL_FACE);
-			glDisable(GL_DEPTH_TEST);
+			// depth & culling are only restored in EndRender when nothing else draws in between
+			state.Enable(GL_CULL_FACE, false);
+			state.Enable(GL_DEPTH_TEST, false);
 
 			pipe::CanvasMaterial* odata = (pipe::CanvasMaterial*)data;
-			odata->Bind();
-			for (PipelineItem* item : odata->Items) {
-				if (item->Type == PipelineItemType::Sprite) {
-					pipe::Sprite* sprite = (pipe::Sprite*)item;
-					odata->SetModelMatrix(sprite->GetMatrix());
-					sprite->Draw();
-				}
+			const std::vector<PipelineOptimizer::DrawGroup>* run = m_optimizer.GetRun(odata);
+			if (run != nullptr) {
+				// part of a reordered run -> the whole run is drawn by its first item
+				for (const auto& group : *run)
+					m_drawMaterials(group.Materials);
+			} else if (odata->HasProgram()) // first compile might not be finished yet
+				m_drawMaterials(std::vector<pipe::CanvasMaterial*>(1, odata));
+
+			if (!m_ownsPipeline) {
+				state.Enable(GL_DEPTH_TEST, true);
+				state.Enable(GL_CULL_FACE, true);
+				state.BindVertexArray(0);
 			}
-
-			glEnable(GL_DEPTH_TEST);
-			glEnable(GL_CULL_FACE);
 		}
 		else if (idata->Type == PipelineItemType::BackBufferCopy)
 		{
-			ResourceManager::Instance().CopiedScreenTexture = false; // just reset the flag -> next shader (if any) that uses SCREEN_TEXTURE will copy the contents
+			pipe::BackBufferCopy* copy = (pipe::BackBufferCopy*)data;
+			if (copy->Snapshot[0] == 0)
+				ResourceManager::Instance().InvalidateSnapshot(0); // just reset the flag -> next shader (if any) that uses SCREEN_TEXTURE will copy the contents
+			else if (copy->SnapshotSlot > 0)
+				ResourceManager::Instance().CaptureSnapshot(copy->SnapshotSlot, GetColorBuffer(), m_fbo);
+		}
+
+		GPUProfiler::Instance().End();
+	}
+	void GodotShaders::m_showProfiler()
+	{
+		GPUProfiler& profiler = GPUProfiler::Instance();
+
+		ImGui::SetNextWindowSize(ImVec2(500, 300), ImGuiCond_Once);
+		if (ImGui::Begin("GPU profiler##gd_profiler", &m_profilerOpened)) {
+			if (ImGui::Button("Reset##gd_profiler_reset"))
+				profiler.Reset();
+			ImGui::SameLine();
+			if (ImGui::Button("Export CSV##gd_profiler_csv")) {
+				std::string path;
+				if (UIHelper::GetSaveFileDialog(path, "csv")) {
+					std::string msg = profiler.ExportCSV(path) ? ("[GodotShaders] GPU timings saved to " + path) : ("[GodotShaders] Failed to write " + path);
+					Log(msg.c_str(), false, nullptr, -1);
+				}
+			}
+			ImGui::SameLine();
+			ImGui::TextDisabled("last %d frames, results are %d frames late", GPU_PROFILER_HISTORY, GPU_PROFILER_FRAMES);
+
+			ImGui::Separator();
+			ImGui::Columns(5, "##gd_profiler_columns");
+			ImGui::Text("Item"); ImGui::NextColumn();
+			ImGui::Text("Last (ms)"); ImGui::NextColumn();
+			ImGui::Text("Min (ms)"); ImGui::NextColumn();
+			ImGui::Text("Avg (ms)"); ImGui::NextColumn();
+			ImGui::Text("P99 (ms)"); ImGui::NextColumn();
+			ImGui::Separator();
+
+			for (const auto& stats : profiler.GetStats()) {
+				// nested scopes -> only show the last part of the name
+				size_t slash = stats.Name.find_last_of('/');
+				std::string name = std::string(stats.Depth * 2, ' ') + (slash == std::string::npos ? stats.Name : stats.Name.substr(slash + 1));
+
+				ImGui::Text("%s", name.c_str()); ImGui::NextColumn();
+				ImGui::Text("%.3f", stats.Last); ImGui::NextColumn();
+				ImGui::Text("%.3f", stats.Min); ImGui::NextColumn();
+				ImGui::Text("%.3f", stats.Avg); ImGui::NextColumn();
+				ImGui::Text("%.3f", stats.P99); ImGui::NextColumn();
+			}
+			ImGui::Columns(1);
+		}
+		ImGui::End();
+	}
+	void GodotShaders::m_drawMaterials(const std::vector<pipe::CanvasMaterial*>& mats)
+	{
+		// all of the materials have the same state -> bind the first one only
+		pipe::CanvasMaterial* odata = mats[0];
+		odata->Bind();
+		if (odata->DrawMode == pipe::SpriteDrawMode::Instanced && odata->IsInstanced()) {
+			SpriteInstancer& instancer = SpriteInstancer::Instance();
+			instancer.Begin(!odata->IsVertexTransformSkipped(), odata->UseTextureAtlas);
+			for (pipe::CanvasMaterial* mat : mats)
+				for (PipelineItem* item : mat->Items)
+					if (item->Type == PipelineItemType::Sprite)
+						instancer.Add((pipe::Sprite*)item);
+			instancer.End();
+		} else if (odata->DrawMode == pipe::SpriteDrawMode::Batched) {
+			// vertices are already in canvas space -> only push them to the same depth as Sprite's matrix does
+			odata->SetModelMatrix(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1000.0f)));
+
+			SpriteBatch& batch = SpriteBatch::Instance();
+			batch.Begin(!odata->IsVertexTransformSkipped(), odata->UseTextureAtlas);
+			for (pipe::CanvasMaterial* mat : mats)
+				for (PipelineItem* item : mat->Items)
+					if (item->Type == PipelineItemType::Sprite)
+						batch.Add((pipe::Sprite*)item);
+			batch.End();
+		} else {
+			for (pipe::CanvasMaterial* mat : mats) {
+				for (PipelineItem* item : mat->Items) {
+					if (item->Type == PipelineItemType::Sprite) {
+						pipe::Sprite* sprite = (pipe::Sprite*)item;
+						odata->SetModelMatrix(sprite->GetMatrix());
+						sprite->Draw();
+					}
+				}
+			}
 		}
 	}
 	void GodotShaders::GetPipelineItemWorldMatrix(const char* name, float(&pMat)[16]) { }
@@ -600,6 +906,8 @@ namespace gd
 				m_varManagerOpened = true;
 				m_popupItem = (PipelineItem*)data;
 			}
+			if (ImGui::Selectable("GPU profiler"))
+				m_profilerOpened = true;
 		}
 	}
 	const char* GodotShaders::ExportPipelineItem(const char* type, void* data)
@@ -618,6 +926,13 @@ namespace gd
 			}
 
 			doc.append_child("path").text().set(actualPath.c_str());
+			doc.append_child("draw_mode").text().set((int)mat->DrawMode);
+			doc.append_child("atlas").text().set(mat->UseTextureAtlas);
+			doc.append_child("ubo").text().set(mat->UseUniformBuffer);
+			doc.append_child("screen_region").text().set(mat->LimitScreenCopy);
+			doc.append_child("screen_margin").text().set(mat->ScreenCopyMargin);
+			if (mat->ScreenSnapshot[0] != 0)
+				doc.append_child("screen_snapshot").text().set(mat->ScreenSnapshot);
 
 			pugi::xml_node uniformsNode = doc.append_child("uniforms");
 
@@ -685,8 +1000,18 @@ namespace gd
 			return m_tempXML.c_str();
 		}
 		else if (strcmp(type, ITEM_NAME_BACKBUFFERCOPY) == 0) {
-			pipe::BackBufferCopy* mat = (pipe::BackBufferCopy*)data;
-			return "";
+			pipe::BackBufferCopy* copy = (pipe::BackBufferCopy*)data;
+			if (copy->Snapshot[0] == 0)
+				return "";
+
+			pugi::xml_document doc;
+			doc.append_child("snapshot").text().set(copy->Snapshot);
+
+			std::ostringstream oss;
+			doc.print(oss);
+			m_tempXML = oss.str();
+
+			return m_tempXML.c_str();
 		}
 
 		return nullptr;
@@ -703,6 +1028,12 @@ namespace gd
 			pipe::CanvasMaterial* mat = (pipe::CanvasMaterial*)item;
 
 			strcpy(mat->ShaderPath, doc.child("path").text().as_string());
+			mat->DrawMode = (pipe::SpriteDrawMode)doc.child("draw_mode").text().as_int();
+			mat->UseTextureAtlas = doc.child("atlas").text().as_bool();
+			mat->UseUniformBuffer = doc.child("ubo").text().as_bool();
+			mat->LimitScreenCopy = doc.child("screen_region").text().as_bool();
+			mat->ScreenCopyMargin = doc.child("screen_margin").text().as_int(mat->ScreenCopyMargin);
+			strncpy(mat->ScreenSnapshot, doc.child("screen_snapshot").text().as_string(), PIPELINE_ITEM_NAME_LENGTH - 1);
 
 			for (const auto& unode : doc.child("uniforms").children("uniform")) {
 				std::string uname(unode.attribute("name").as_string());
@@ -768,6 +1099,8 @@ namespace gd
 		else if (strcmp(type, ITEM_NAME_BACKBUFFERCOPY) == 0)
 		{
 			item = new pipe::BackBufferCopy();
+			pipe::BackBufferCopy* copy = (pipe::BackBufferCopy*)item;
+			strncpy(copy->Snapshot, doc.child("snapshot").text().as_string(), PIPELINE_ITEM_NAME_LENGTH - 1);
 		}
 
 		strcpy(item->Name, name);
@@ -831,8 +1164,61 @@ namespace gd
 	}
 
 	// options
-	bool GodotShaders::HasSectionInOptions() { return false; }
-	void GodotShaders::ShowOptions() { }
+	bool GodotShaders::HasSectionInOptions() { return true; }
+	void GodotShaders::ShowOptions()
+	{
+		ResourceManager& res = ResourceManager::Instance();
+
+		/* SCREEN_TEXTURE */
+		ImGui::Text("SCREEN_TEXTURE blur:");
+		ImGui::SameLine();
+		int downsample = (int)res.Downsample;
+		const char* downsampleNames = res.IsComputeSupported() ? "Two passes\0One pass\0Compute shader\0" : "Two passes\0One pass\0";
+		if (ImGui::Combo("##gd_opt_downsample", &downsample, downsampleNames))
+			res.Downsample = (DownsampleMode)downsample;
+
+		ImGui::Text("SCREEN_TEXTURE format:");
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Stored in the project. RGBA8 clamps HDR colors, R11F_G11F_B10F has no alpha channel.");
+		ImGui::SameLine();
+		int format = (int)res.GetScreenTextureFormat();
+		if (ImGui::Combo("##gd_opt_screenformat", &format, "RGBA8\0RGB10_A2\0R11F_G11F_B10F\0RGBA16F\0")) {
+			res.SetScreenTextureFormat((ScreenTextureFormat)format);
+			ModifyProject(Project);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Benchmark##gd_opt_formatbench")) {
+			std::string report = "[GodotShaders] " + res.BenchmarkScreenFormats(GetColorBuffer(), m_fbo);
+			Log(report.c_str(), false, nullptr, -1);
+		}
+
+		ImGui::Checkbox("Blit SCREEN_TEXTURE instead of drawing it##gd_opt_fastcopy", &res.FastScreenCopy);
+		ImGui::SameLine();
+		if (ImGui::Button("Benchmark##gd_opt_copybench")) {
+			std::string report = "[GodotShaders] " + res.BenchmarkScreenCopy(GetColorBuffer(), m_fbo);
+			Log(report.c_str(), false, nullptr, -1);
+		}
+
+		/* SHADER EDITOR */
+		ImGui::Checkbox("Skip recompiling comment & whitespace edits##gd_opt_incremental", &m_incrementalCompile);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Edits in the code editor that don't change the shader's code keep the current program\ninstead of running the transcompiler & the driver's compiler again.");
+
+		/* GL STATE */
+		GLState& state = GLState::Instance();
+		ImGui::Text("GL state changes last frame: %d issued, %d skipped", state.GetIssuedCount(), state.GetSkippedCount());
+		ImGui::Checkbox("Show frame statistics##gd_opt_framestats", &FrameStats::Instance().ShowOverlay);
+
+		/* PIPELINE OPTIMIZER */
+		if (ImGui::Checkbox("Reorder & merge materials##gd_opt_optimizer", &m_optimizer.Enabled))
+			ModifyProject(Project);
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip("Stored in the project. Materials that don't read SCREEN_TEXTURE are sorted by shader, texture & blend mode\nwhen their sprites don't overlap or they use the same add/sub/mul blending.");
+		if (m_optimizer.Enabled) {
+			ImGui::SameLine();
+			ImGui::Text("%d reordered, %d merged", m_optimizer.GetReorderedCount(), m_optimizer.GetMergedCount());
+		}
+	}
 
 	// code editor
 	void GodotShaders::m_buildLangDefinition()
@@ -1100,7 +1486,7 @@ namespace gd
 				strcmp(item->Name, itemName) == 0)
 			{
 				gd::pipe::CanvasMaterial* data = (gd::pipe::CanvasMaterial*)item;
-				data->CompileFromSource(shaderCode, shaderSize);
+				data->QueueCompileFromSource(shaderCode, shaderSize, m_incrementalCompile);
 			}
 		}
 	}
@@ -3,6 +3,7 @@
 #include <Core/Sprite.h>
 #include <Core/PipelineItem.h>
 #include <Core/CanvasMaterial.h>
+#include <Core/PipelineOptimizer.h>
 
 #include <vector>
 #include <string>
@@ -134,6 +135,7 @@ namespace gd
 
 		inline unsigned int GetFBO() { return m_fbo; }
 		inline unsigned int GetColorBuffer() { return GetWindowColorTexture(Renderer); }
+		std::vector<std::string> GetSnapshotNames(); // named BackBufferCopy snapshots
 
 		bool ShaderPathsUpdated;
 	private:
@@ -143,6 +145,10 @@ namespace gd
 		float m_lastErrorCheck;
 
 		bool m_varManagerOpened;
+		bool m_profilerOpened;
+		void m_showProfiler();
+
+		bool m_incrementalCompile; // HandleRecompileFromSource skips edits that only touch comments & whitespace
 				
 		bool m_createSpritePopup;
 		std::string m_createSpriteTexture;
@@ -151,6 +157,15 @@ namespace gd
 		std::vector<std::pair<const char*, ed::plugin::TextEditorPaletteIndex>> m_langDefRegex;
 		std::vector<std::pair<const char*, const char*>> m_langDefIdentifiers;
 		void m_buildLangDefinition();
+
+		void m_loadProjectSettings();
+		void m_saveProjectSettings();
+
+		void m_scheduleSnapshots();
+
+		PipelineOptimizer m_optimizer;
+		void m_drawMaterials(const std::vector<pipe::CanvasMaterial*>& mats); // binds mats[0], draws the sprites of all of them
+
 		std::vector<std::string> m_editorOpened;
 		std::vector<int> m_editorID;
 		int m_editorCurrentID;
@@ -158,6 +173,7 @@ namespace gd
 		glm::vec2 m_rtSize, m_lastSize;
 		glm::vec4 m_clearColor;
 		GLuint m_fbo;
+		bool m_ownsPipeline; // only plugin items in the pipeline -> GL state stays valid between them
 
 		PipelineItem* m_popupItem;
 		
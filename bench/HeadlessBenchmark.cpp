@@ -0,0 +1,609 @@
+// Runs GodotShaders without SHADERed: a minimal IPlugin host, an offscreen EGL context and a synthetic project
+// usage: GodotShadersBench [--materials N] [--sprites M] [--frames F] [--size WxH] [--mode individual|batched|instanced]
+//                          [--blend mix|add] [--screen-every K] [--unique-shaders] [--optimize]
+//        GodotShadersBench --check-screen-texture [--size WxH] -> renders a test scene & compares the pixels, exit code 0 on success
+#include "../GodotShaders.h"
+#include <Core/CanvasMaterial.h>
+#include <Core/FrameStats.h>
+#include <Core/Settings.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <ghc/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_TEXTURE_COUNT 4
+#define BENCH_TEXTURE_SIZE 64
+
+namespace bench
+{
+	struct Options
+	{
+		int Materials = 16;
+		int Sprites = 64;
+		int Frames = 300;
+		int Width = 1280, Height = 720;
+		int DrawMode = 0; // pipe::SpriteDrawMode
+		bool AddBlend = false;
+		int ScreenEvery = 0; // every K-th material reads SCREEN_TEXTURE, 0 -> none
+		bool UniqueShaders = false; // defeats program sharing between materials
+		bool Optimize = false;
+		bool CheckScreenTexture = false;
+	};
+
+	// state behind the SHADERed function pointers
+	struct Host
+	{
+		std::string ProjectDir;
+		std::vector<std::string> TextureNames;
+		std::vector<unsigned int> Textures;
+		std::vector<void*> Pipeline; // top level items
+		unsigned int ColorTexture = 0, DepthTexture = 0;
+		int Width = 0, Height = 0;
+		float Time = 0.0f;
+		int FrameIndex = 0;
+		int Errors = 0;
+	} host;
+
+	double toMs(std::chrono::high_resolution_clock::duration d)
+	{
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	/* SHADERed stubs */
+	void addObject(void* objects, const char* name, const char* type, void* data, unsigned int id, void* owner) { }
+	bool addCustomPipelineItem(void* pipeline, void* parent, const char* name, const char* type, void* data, void* owner) { return false; }
+	void addMessage(void* messages, ed::plugin::MessageType mtype, const char* group, const char* txt, int ln)
+	{
+		if (mtype == ed::plugin::MessageType::Error) {
+			host.Errors++;
+			fprintf(stderr, "%s %s (line %d)\n", group, txt, ln);
+		}
+	}
+	bool createRenderTexture(void* objects, const char* name) { return false; }
+	bool createImage(void* objects, const char* name, int width, int height) { return false; }
+	void resizeRenderTexture(void* objects, const char* name, int width, int height) { }
+	void resizeImage(void* objects, const char* name, int width, int height) { }
+	int findTexture(const char* name)
+	{
+		for (size_t i = 0; i < host.TextureNames.size(); i++)
+			if (host.TextureNames[i] == name)
+				return i;
+		return -1;
+	}
+	bool existsObject(void* objects, const char* name) { return findTexture(name) >= 0; }
+	void removeGlobalObject(void* objects, const char* name) { }
+	void getProjectPath(void* project, const char* filename, char* out)
+	{
+		std::string path = host.ProjectDir + "/" + filename;
+		strncpy(out, path.c_str(), MAX_PATH_LENGTH - 1);
+		out[MAX_PATH_LENGTH - 1] = 0;
+	}
+	void getRelativePath(void* project, const char* filename, char* out)
+	{
+		std::string path = ghc::filesystem::relative(filename, host.ProjectDir).generic_string();
+		strncpy(out, path.c_str(), MAX_PATH_LENGTH - 1);
+		out[MAX_PATH_LENGTH - 1] = 0;
+	}
+	void getProjectFilename(void* project, char* out) { strcpy(out, "bench.sprj"); }
+	const char* getProjectDirectory(void* project) { return host.ProjectDir.c_str(); }
+	bool isProjectModified(void* project) { return false; }
+	void modifyProject(void* project) { }
+	void openProject(void* project, void* ui, const char* filename) { }
+	void saveProject(void* project) { }
+	void saveAsProject(void* project, const char* filename, bool copyFiles) { }
+	bool isPaused(void* renderer) { return false; }
+	void pause(void* renderer, bool state) { }
+	unsigned int getWindowColorTexture(void* renderer) { return host.ColorTexture; }
+	unsigned int getWindowDepthTexture(void* renderer) { return host.DepthTexture; }
+	void getLastRenderSize(void* renderer, int& w, int& h) { w = host.Width; h = host.Height; }
+	void render(void* renderer, int w, int h) { }
+	bool existsPipelineItem(void* pipeline, const char* name)
+	{
+		for (void* item : host.Pipeline)
+			if (strcmp(((gd::PipelineItem*)item)->Name, name) == 0)
+				return true;
+		return false;
+	}
+	void* getPipelineItem(void* pipeline, const char* name)
+	{
+		for (void* item : host.Pipeline)
+			if (strcmp(((gd::PipelineItem*)item)->Name, name) == 0)
+				return item;
+		return nullptr;
+	}
+	int getPipelineItemCount(void* pipeline) { return host.Pipeline.size(); }
+	ed::plugin::PipelineItemType getPipelineItemType(void* pipeline, int index) { return ed::plugin::PipelineItemType::PluginItem; }
+	void* getPipelineItemByIndex(void* pipeline, int index) { return host.Pipeline[index]; }
+	void bindShaderPassVariables(void* shaderpass, void* item) { }
+	void getIdentityMatrix(float* out)
+	{
+		for (int i = 0; i < 16; i++)
+			out[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+	}
+	void getViewportSize(float& w, float& h) { w = host.Width; h = host.Height; }
+	void advanceTimer(float t) { host.Time += t; }
+	void getMousePosition(float& x, float& y) { x = y = 0.0f; }
+	int getFrameIndex() { return host.FrameIndex; }
+	float getTime() { return host.Time; }
+	void setGeometryTransform(void* item, float scale[3], float rota[3], float pos[3]) { }
+	void setMousePosition(float x, float y) { }
+	void setKeysWASD(bool w, bool a, bool s, bool d) { }
+	void setFrameIndex(int findex) { host.FrameIndex = findex; }
+	float getDPI() { return 1.0f; }
+	bool fileExists(void* project, const char* path) { return ghc::filesystem::exists(host.ProjectDir + "/" + path); }
+	void clearMessageGroup(void* messages, const char* group) { }
+	void log(const char* msg, bool error, const char* file, int line) { fprintf(error ? stderr : stdout, "%s\n", msg); }
+	int getObjectCount(void* objects) { return host.TextureNames.size(); }
+	const char* getObjectName(void* objects, int index) { return host.TextureNames[index].c_str(); }
+	bool isTexture(void* objects, const char* name) { return findTexture(name) >= 0; }
+	unsigned int getTexture(void* objects, const char* name)
+	{
+		int index = findTexture(name);
+		return index >= 0 ? host.Textures[index] : 0;
+	}
+	void getTextureSize(void* objects, const char* name, int& w, int& h) { w = h = BENCH_TEXTURE_SIZE; }
+	void bindDefaultState() { }
+	void openInCodeEditor(void* CodeEditorUI, void* item, const char* filename, int id) { }
+	bool getOpenDirectoryDialog(char* out) { return false; }
+	bool getOpenFileDialog(char* out, const char* files) { return false; }
+	bool getSaveFileDialog(char* out, const char* files) { return false; }
+
+	void connect(ed::IPlugin* plugin)
+	{
+		plugin->ObjectManager = nullptr;
+		plugin->PipelineManager = nullptr;
+		plugin->Renderer = plugin->Messages = plugin->Project = plugin->CodeEditor = plugin->UI = nullptr;
+
+		plugin->AddObject = addObject;
+		plugin->AddCustomPipelineItem = addCustomPipelineItem;
+		plugin->AddMessage = addMessage;
+		plugin->CreateRenderTexture = createRenderTexture;
+		plugin->CreateImage = createImage;
+		plugin->ResizeRenderTexture = resizeRenderTexture;
+		plugin->ResizeImage = resizeImage;
+		plugin->ExistsObject = existsObject;
+		plugin->RemoveGlobalObject = removeGlobalObject;
+		plugin->GetProjectPath = getProjectPath;
+		plugin->GetRelativePath = getRelativePath;
+		plugin->GetProjectFilename = getProjectFilename;
+		plugin->GetProjectDirectory = getProjectDirectory;
+		plugin->IsProjectModified = isProjectModified;
+		plugin->ModifyProject = modifyProject;
+		plugin->OpenProject = openProject;
+		plugin->SaveProject = saveProject;
+		plugin->SaveAsProject = saveAsProject;
+		plugin->IsPaused = isPaused;
+		plugin->Pause = pause;
+		plugin->GetWindowColorTexture = getWindowColorTexture;
+		plugin->GetWindowDepthTexture = getWindowDepthTexture;
+		plugin->GetLastRenderSize = getLastRenderSize;
+		plugin->Render = render;
+		plugin->ExistsPipelineItem = existsPipelineItem;
+		plugin->GetPipelineItem = getPipelineItem;
+		plugin->BindShaderPassVariables = bindShaderPassVariables;
+		plugin->GetViewMatrix = getIdentityMatrix;
+		plugin->GetProjectionMatrix = getIdentityMatrix;
+		plugin->GetOrthographicMatrix = getIdentityMatrix;
+		plugin->GetViewportSize = getViewportSize;
+		plugin->AdvanceTimer = advanceTimer;
+		plugin->GetMousePosition = getMousePosition;
+		plugin->GetFrameIndex = getFrameIndex;
+		plugin->GetTime = getTime;
+		plugin->SetGeometryTransform = setGeometryTransform;
+		plugin->SetMousePosition = setMousePosition;
+		plugin->SetKeysWASD = setKeysWASD;
+		plugin->SetFrameIndex = setFrameIndex;
+		plugin->GetDPI = getDPI;
+		plugin->FileExists = fileExists;
+		plugin->ClearMessageGroup = clearMessageGroup;
+		plugin->Log = log;
+		plugin->GetObjectCount = getObjectCount;
+		plugin->GetObjectName = getObjectName;
+		plugin->IsTexture = isTexture;
+		plugin->GetTexture = getTexture;
+		plugin->GetFlippedTexture = getTexture;
+		plugin->GetTextureSize = getTextureSize;
+		plugin->BindDefaultState = bindDefaultState;
+		plugin->OpenInCodeEditor = openInCodeEditor;
+		plugin->GetPipelineItemCount = getPipelineItemCount;
+		plugin->GetPipelineItemType = getPipelineItemType;
+		plugin->GetPipelineItemByIndex = getPipelineItemByIndex;
+		plugin->GetOpenDirectoryDialog = getOpenDirectoryDialog;
+		plugin->GetOpenFileDialog = getOpenFileDialog;
+		plugin->GetSaveFileDialog = getSaveFileDialog;
+	}
+
+	/* offscreen context, works with Mesa's llvmpipe */
+	bool createContext()
+	{
+		EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+			fprintf(stderr, "Failed to initialize EGL\n");
+			return false;
+		}
+
+		const EGLint configAttribs[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+			EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+		EGLConfig config;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+			fprintf(stderr, "No EGL config with desktop OpenGL support\n");
+			return false;
+		}
+
+		// the plugin renders to its own FBO, the surface is never drawn to
+		const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+		EGLSurface surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+
+		eglBindAPI(EGL_OPENGL_API);
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+		if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context)) {
+			fprintf(stderr, "Failed to create a GL 3.3 core context\n");
+			return false;
+		}
+
+		glewExperimental = GL_TRUE;
+		GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+		// GLEW built for GLX complains about the missing X display but loads the functions anyway
+		if (err == GLEW_ERROR_NO_GLX_DISPLAY)
+			err = GLEW_OK;
+#endif
+		if (err != GLEW_OK) {
+			fprintf(stderr, "Failed to initialize GLEW: %s\n", glewGetErrorString(err));
+			return false;
+		}
+
+		printf("GL_RENDERER: %s\nGL_VERSION: %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+		return true;
+	}
+
+	/* synthetic project */
+	void createRenderTargets()
+	{
+		glGenTextures(1, &host.ColorTexture);
+		glBindTexture(GL_TEXTURE_2D, host.ColorTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, host.Width, host.Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		glGenTextures(1, &host.DepthTexture);
+		glBindTexture(GL_TEXTURE_2D, host.DepthTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, host.Width, host.Height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+
+		// checkered sprite textures with different colors
+		std::vector<unsigned char> pixels(BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE * 4);
+		for (int t = 0; t < BENCH_TEXTURE_COUNT; t++) {
+			for (int i = 0; i < BENCH_TEXTURE_SIZE * BENCH_TEXTURE_SIZE; i++) {
+				bool odd = ((i % BENCH_TEXTURE_SIZE) / 8 + (i / BENCH_TEXTURE_SIZE) / 8) % 2;
+				pixels[i * 4 + 0] = odd ? 255 : 64 * t;
+				pixels[i * 4 + 1] = odd ? 255 : 255 - 64 * t;
+				pixels[i * 4 + 2] = odd ? 255 : 128;
+				pixels[i * 4 + 3] = 255;
+			}
+
+			unsigned int tex;
+			glGenTextures(1, &tex);
+			glBindTexture(GL_TEXTURE_2D, tex);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, BENCH_TEXTURE_SIZE, BENCH_TEXTURE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+			host.Textures.push_back(tex);
+			host.TextureNames.push_back("texture" + std::to_string(t) + ".png");
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	std::string createShader(const Options& opts, int index)
+	{
+		bool screen = opts.ScreenEvery > 0 && index % opts.ScreenEvery == 0;
+		int variant = opts.UniqueShaders ? index : 0;
+
+		std::string src = "shader_type canvas_item;\n";
+		src += opts.AddBlend ? "render_mode blend_add;\n" : "render_mode blend_mix;\n";
+		src += "uniform vec4 tint : hint_color = vec4(1.0);\n";
+		src += "uniform float strength : hint_range(0.0, 1.0) = 0.5;\n";
+		src += "const float VARIANT = " + std::to_string(variant) + ".0;\n\n";
+		src += "void fragment() {\n";
+		src += "\tvec4 c = texture(TEXTURE, UV);\n";
+		src += "\tc.rgb = mix(c.rgb, c.rgb * tint.rgb, strength) + vec3(VARIANT * 0.001);\n";
+		if (screen)
+			src += "\tc.rgb = mix(c.rgb, textureLod(SCREEN_TEXTURE, SCREEN_UV, 2.0).rgb, 0.5);\n";
+		src += "\tCOLOR = c * COLOR;\n";
+		src += "}\n";
+
+		// materials without SCREEN_TEXTURE share one file -> one program when the shaders are the same
+		std::string filename = (opts.UniqueShaders || screen) ? ("shaders/material" + std::to_string(index) + ".shader") : "shaders/shared.shader";
+		std::ofstream(host.ProjectDir + "/" + filename) << src;
+		return filename;
+	}
+	void loadProject(gd::GodotShaders* plugin, const Options& opts, std::vector<gd::pipe::CanvasMaterial*>& materials)
+	{
+		ghc::filesystem::create_directories(host.ProjectDir + "/shaders");
+
+		plugin->BeginProjectLoading();
+
+		for (int m = 0; m < opts.Materials; m++) {
+			std::string name = "material" + std::to_string(m);
+			std::string xml = "<path>" + createShader(opts, m) + "</path>"
+				"<draw_mode>" + std::to_string(opts.DrawMode) + "</draw_mode>"
+				"<atlas>true</atlas>"
+				"<screen_region>true</screen_region>"
+				"<uniforms><uniform name=\"strength\" type=\"float\"><value>" + std::to_string((m % 4) * 0.25f) + "</value></uniform></uniforms>";
+			void* mat = plugin->ImportPipelineItem(nullptr, name.c_str(), ITEM_NAME_CANVAS_MATERIAL, xml.c_str());
+			host.Pipeline.push_back(mat);
+			materials.push_back((gd::pipe::CanvasMaterial*)mat);
+
+			for (int s = 0; s < opts.Sprites; s++) {
+				// sprites are spread over the whole viewport, every material covers a different part of it
+				int index = m * opts.Sprites + s;
+				float x = (index * 37) % host.Width;
+				float y = (index * 91) % host.Height;
+
+				std::string sprName = "sprite" + std::to_string(index);
+				std::string sprXml = "<width>48</width><height>48</height>"
+					"<x>" + std::to_string(x) + "</x><y>" + std::to_string(y) + "</y>"
+					"<rotation>" + std::to_string((index % 8) * 45) + "</rotation>"
+					"<fliph>false</fliph><flipv>false</flipv><visible>true</visible>"
+					"<color_r>1</color_r><color_g>1</color_g><color_b>1</color_b><color_a>0.75</color_a>"
+					"<texture>" + host.TextureNames[index % BENCH_TEXTURE_COUNT] + "</texture>";
+				void* spr = plugin->ImportPipelineItem(name.c_str(), sprName.c_str(), ITEM_NAME_SPRITE, sprXml.c_str());
+				plugin->AddPipelineItemChild(name.c_str(), sprName.c_str(), ed::plugin::PipelineItemType::PluginItem, spr);
+			}
+		}
+
+		if (opts.Optimize)
+			std::ofstream(host.ProjectDir + "/.gdshaders") << "<settings><optimize_pipeline>true</optimize_pipeline></settings>";
+
+		plugin->EndProjectLoading();
+	}
+
+	/* checks */
+	// SCREEN_TEXTURE passed to a user function can't have its UVs scaled -> the pooled texture must not be used as is
+	// first material writes SCREEN_UV as a color, the second one copies SCREEN_TEXTURE through a helper function
+	int checkScreenTexture(gd::GodotShaders* plugin)
+	{
+		const char* shaders[2] = {
+			"shader_type canvas_item;\n"
+			"void fragment() {\n"
+			"\tCOLOR = vec4(SCREEN_UV, 0.5, 1.0);\n"
+			"}\n",
+
+			"shader_type canvas_item;\n"
+			"vec4 read_screen(sampler2D screen, vec2 uv) {\n"
+			"\treturn textureLod(screen, uv, 0.0);\n"
+			"}\n"
+			"void fragment() {\n"
+			"\tCOLOR = read_screen(SCREEN_TEXTURE, SCREEN_UV);\n"
+			"}\n"
+		};
+
+		ghc::filesystem::create_directories(host.ProjectDir + "/shaders");
+		plugin->BeginProjectLoading();
+
+		std::vector<gd::pipe::CanvasMaterial*> materials;
+		for (int m = 0; m < 2; m++) {
+			std::string name = "check" + std::to_string(m);
+			std::string filename = "shaders/" + name + ".shader";
+			std::ofstream(host.ProjectDir + "/" + filename) << shaders[m];
+
+			std::string xml = "<path>" + filename + "</path>";
+			void* mat = plugin->ImportPipelineItem(nullptr, name.c_str(), ITEM_NAME_CANVAS_MATERIAL, xml.c_str());
+			host.Pipeline.push_back(mat);
+			materials.push_back((gd::pipe::CanvasMaterial*)mat);
+
+			// one sprite over the whole viewport
+			std::string sprName = name + "_sprite";
+			std::string sprXml = "<width>" + std::to_string(host.Width) + "</width><height>" + std::to_string(host.Height) + "</height>"
+				"<x>0</x><y>0</y><rotation>0</rotation>"
+				"<fliph>false</fliph><flipv>false</flipv><visible>true</visible>"
+				"<color_r>1</color_r><color_g>1</color_g><color_b>1</color_b><color_a>1</color_a>"
+				"<texture>" + host.TextureNames[0] + "</texture>";
+			void* spr = plugin->ImportPipelineItem(name.c_str(), sprName.c_str(), ITEM_NAME_SPRITE, sprXml.c_str());
+			plugin->AddPipelineItemChild(name.c_str(), sprName.c_str(), ed::plugin::PipelineItemType::PluginItem, spr);
+		}
+
+		plugin->EndProjectLoading();
+		for (auto mat : materials)
+			mat->WaitForCompile();
+
+		// second frame -> the SCREEN_TEXTURE size decision was made with both programs in place
+		for (int f = 0; f < 2; f++) {
+			plugin->BeginRender();
+			for (void* item : host.Pipeline)
+				plugin->ExecutePipelineItem(ITEM_NAME_CANVAS_MATERIAL, item, nullptr, 0);
+			plugin->EndRender();
+		}
+
+		std::vector<unsigned char> pixels(host.Width * host.Height * 4);
+		glBindTexture(GL_TEXTURE_2D, host.ColorTexture);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		// every pixel has to hold its own SCREEN_UV, not the one of a scaled position
+		int failed = 0, maxError = 0;
+		for (int y = 0; y < host.Height; y++) {
+			for (int x = 0; x < host.Width; x++) {
+				const unsigned char* px = &pixels[(y * host.Width + x) * 4];
+				int r = (int)std::lround((x + 0.5) / host.Width * 255.0);
+				int g = (int)std::lround((y + 0.5) / host.Height * 255.0);
+				int error = std::max(std::abs(px[0] - r), std::abs(px[1] - g));
+				maxError = std::max(maxError, error);
+				if (error > 2)
+					failed++;
+			}
+		}
+
+		printf("screen texture check (%dx%d): %d wrong pixels, max error %d\n", host.Width, host.Height, failed, maxError);
+		return (failed > 0 || host.Errors > 0) ? 3 : 0;
+	}
+
+	bool parseArgs(int argc, char** argv, Options& opts)
+	{
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--materials" && hasValue)
+				opts.Materials = std::max(1, atoi(argv[++i]));
+			else if (arg == "--sprites" && hasValue)
+				opts.Sprites = std::max(0, atoi(argv[++i]));
+			else if (arg == "--frames" && hasValue)
+				opts.Frames = std::max(1, atoi(argv[++i]));
+			else if (arg == "--size" && hasValue) {
+				if (sscanf(argv[++i], "%dx%d", &opts.Width, &opts.Height) != 2 || opts.Width <= 0 || opts.Height <= 0)
+					return false;
+			} else if (arg == "--mode" && hasValue) {
+				std::string mode = argv[++i];
+				if (mode == "individual") opts.DrawMode = (int)gd::pipe::SpriteDrawMode::Individual;
+				else if (mode == "batched") opts.DrawMode = (int)gd::pipe::SpriteDrawMode::Batched;
+				else if (mode == "instanced") opts.DrawMode = (int)gd::pipe::SpriteDrawMode::Instanced;
+				else return false;
+			} else if (arg == "--blend" && hasValue) {
+				std::string blend = argv[++i];
+				if (blend != "mix" && blend != "add")
+					return false;
+				opts.AddBlend = blend == "add";
+			} else if (arg == "--screen-every" && hasValue)
+				opts.ScreenEvery = std::max(0, atoi(argv[++i]));
+			else if (arg == "--unique-shaders")
+				opts.UniqueShaders = true;
+			else if (arg == "--optimize")
+				opts.Optimize = true;
+			else if (arg == "--check-screen-texture")
+				opts.CheckScreenTexture = true;
+			else
+				return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace bench;
+	typedef std::chrono::high_resolution_clock clock;
+
+	Options opts;
+	if (!parseArgs(argc, argv, opts)) {
+		printf("usage: %s [--materials N] [--sprites M] [--frames F] [--size WxH] [--mode individual|batched|instanced]\n"
+			"          [--blend mix|add] [--screen-every K] [--unique-shaders] [--optimize]\n"
+			"       %s --check-screen-texture [--size WxH]\n", argv[0], argv[0]);
+		return 1;
+	}
+
+	if (!createContext())
+		return 1;
+
+	host.Width = opts.Width;
+	host.Height = opts.Height;
+	host.ProjectDir = (ghc::filesystem::temp_directory_path() / ("gdshaders_bench_" + std::to_string(clock::now().time_since_epoch().count()))).generic_string();
+	createRenderTargets();
+
+	gd::GodotShaders* plugin = new gd::GodotShaders();
+	connect(plugin);
+	plugin->Init();
+
+	if (opts.CheckScreenTexture) {
+		int ret = checkScreenTexture(plugin);
+
+		plugin->Destroy();
+		delete plugin;
+
+		std::error_code errc;
+		ghc::filesystem::remove_all(host.ProjectDir, errc);
+
+		return ret;
+	}
+
+	// load = creating the items + reading & compiling the shaders in EndProjectLoading
+	std::vector<gd::pipe::CanvasMaterial*> materials;
+	auto loadStart = clock::now();
+	loadProject(plugin, opts, materials);
+	auto loadEnd = clock::now();
+
+	// compile = the same shaders compiled again, the shader cache in the project directory is warm now
+	auto compileStart = clock::now();
+	for (auto mat : materials)
+		mat->Compile();
+	for (auto mat : materials)
+		mat->WaitForCompile();
+	auto compileEnd = clock::now();
+
+	// frames -> glFinish so that the GPU time is included
+	std::vector<double> frameTimes;
+	std::vector<int> counters((int)gd::FrameCounter::Count, 0);
+	for (int f = 0; f < opts.Frames + 1; f++) {
+		auto frameStart = clock::now();
+
+		plugin->BeginRender();
+
+		// BeginRender() moved the previous frame's counters to "last frame", the first frame is skipped
+		if (f >= 2)
+			for (int i = 0; i < (int)gd::FrameCounter::Count; i++)
+				counters[i] += gd::FrameStats::Instance().Get((gd::FrameCounter)i);
+
+		for (void* item : host.Pipeline)
+			plugin->ExecutePipelineItem(ITEM_NAME_CANVAS_MATERIAL, item, nullptr, 0);
+		plugin->EndRender();
+		glFinish();
+
+		auto frameEnd = clock::now();
+		host.Time += 1.0f / 60.0f;
+		host.FrameIndex++;
+
+		// first frame creates the SCREEN_TEXTURE & batch buffers
+		if (f > 0)
+			frameTimes.push_back(toMs(frameEnd - frameStart));
+	}
+	gd::FrameStats::Instance().BeginFrame();
+	for (int i = 0; i < (int)gd::FrameCounter::Count; i++)
+		counters[i] += gd::FrameStats::Instance().Get((gd::FrameCounter)i);
+
+	std::vector<double> sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (double t : sorted)
+		sum += t;
+
+	printf("\nmaterials: %d, sprites per material: %d, viewport: %dx%d, frames: %d\n", opts.Materials, opts.Sprites, opts.Width, opts.Height, opts.Frames);
+	printf("load_ms: %.3f\n", toMs(loadEnd - loadStart));
+	printf("compile_ms: %.3f\n", toMs(compileEnd - compileStart));
+	printf("frame_ms_min: %.3f\n", sorted.front());
+	printf("frame_ms_avg: %.3f\n", sum / sorted.size());
+	printf("frame_ms_p99: %.3f\n", sorted[std::min<size_t>(sorted.size() - 1, (size_t)(sorted.size() * 0.99))]);
+	for (int i = 0; i < (int)gd::FrameCounter::Count; i++)
+		printf("%s_per_frame: %.1f\n", gd::FrameStats::GetName((gd::FrameCounter)i), (double)counters[i] / opts.Frames);
+	printf("errors: %d\n", host.Errors);
+
+	plugin->Destroy();
+	delete plugin;
+
+	std::error_code errc;
+	ghc::filesystem::remove_all(host.ProjectDir, errc);
+
+	return host.Errors > 0 ? 2 : 0;
+}
\ No newline at end of file
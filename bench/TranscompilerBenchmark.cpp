@@ -0,0 +1,432 @@
+// Measures gd::ShaderTranscompiler::Transcompile over a corpus of canvas_item shaders
+// usage: GodotShadersTranscompilerBench [--corpus DIR] [--iterations N] [--warmup N] [--json [FILE]] [--tag NAME]
+#include <GodotShaderTranscompiler/ShaderTranscompiler.h>
+
+#include <ghc/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+#ifndef GODOTSHADERS_BENCH_CORPUS
+	#define GODOTSHADERS_BENCH_CORPUS "bench/shaders"
+#endif
+
+#define BENCH_ALLOC_HEADER 16 // keeps the returned pointer aligned for any fundamental type
+
+/* allocation tracking */
+// only operator new is seen, which covers the std containers the transcompiler is built on
+namespace bench
+{
+	size_t allocCount = 0;
+	size_t allocBytes = 0;
+	size_t liveBytes = 0;
+	size_t peakBytes = 0;
+
+	inline void* trackedAlloc(size_t size)
+	{
+		unsigned char* ptr = (unsigned char*)malloc(size + BENCH_ALLOC_HEADER);
+		if (ptr == nullptr)
+			return nullptr;
+
+		*(size_t*)ptr = size;
+
+		allocCount++;
+		allocBytes += size;
+		liveBytes += size;
+		peakBytes = std::max(peakBytes, liveBytes);
+
+		return ptr + BENCH_ALLOC_HEADER;
+	}
+	inline void trackedFree(void* data)
+	{
+		if (data == nullptr)
+			return;
+
+		unsigned char* ptr = (unsigned char*)data - BENCH_ALLOC_HEADER;
+		liveBytes -= *(size_t*)ptr;
+		free(ptr);
+	}
+}
+
+void* operator new(size_t size)
+{
+	void* ret = bench::trackedAlloc(size);
+	if (ret == nullptr)
+		throw std::bad_alloc();
+	return ret;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return bench::trackedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return bench::trackedAlloc(size); }
+void operator delete(void* ptr) noexcept { bench::trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { bench::trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { bench::trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { bench::trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { bench::trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { bench::trackedFree(ptr); }
+
+namespace bench
+{
+	struct Options
+	{
+		std::string Corpus = GODOTSHADERS_BENCH_CORPUS;
+		int Iterations = 200;
+		int Warmup = 5;
+		bool JSON = false;
+		std::string JSONPath; // empty -> stdout
+		std::string Tag;
+	};
+
+	struct Shader
+	{
+		std::string Name;
+		std::string Code;
+	};
+
+	struct Result
+	{
+		std::string Name;
+		size_t Bytes = 0;
+		int Iterations = 0;
+		double MinMs = 0.0, AvgMs = 0.0, TotalMs = 0.0;
+		double ShadersPerSecond = 0.0, BytesPerSecond = 0.0;
+		double AllocsPerCompile = 0.0, AllocBytesPerCompile = 0.0;
+		size_t PeakHeapBytes = 0; // largest heap growth during one compile
+		bool Error = false;
+		std::string ErrorMessage;
+		int ErrorLine = 0;
+	};
+
+	double toMs(std::chrono::high_resolution_clock::duration d)
+	{
+		return std::chrono::duration<double, std::milli>(d).count();
+	}
+
+	size_t getPeakRSS()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS pmc;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+			return pmc.PeakWorkingSetSize;
+		return 0;
+#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+	#if defined(__APPLE__)
+		return usage.ru_maxrss; // bytes
+	#else
+		return usage.ru_maxrss * 1024; // kilobytes
+	#endif
+#endif
+	}
+
+	std::string escapeJSON(const std::string& str)
+	{
+		std::string ret;
+		ret.reserve(str.size());
+		for (char c : str) {
+			switch (c) {
+			case '"': ret += "\\\""; break;
+			case '\\': ret += "\\\\"; break;
+			case '\n': ret += "\\n"; break;
+			case '\r': ret += "\\r"; break;
+			case '\t': ret += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20) {
+					char buf[8];
+					snprintf(buf, sizeof(buf), "\\u%04x", c);
+					ret += buf;
+				} else
+					ret += c;
+			}
+		}
+		return ret;
+	}
+
+	/* generated corpus */
+	// a lot of uniforms of every common type, all of them referenced from fragment()
+	std::string generateUniforms(int count)
+	{
+		static const char* types[] = { "float", "vec2", "vec3", "vec4", "int" };
+		static const char* swizzle[] = { "", ".x", ".x", ".x", "" };
+
+		std::stringstream ss;
+		ss << "shader_type canvas_item;\n\n";
+		for (int i = 0; i < count; i++) {
+			int t = i % 5;
+			ss << "uniform " << types[t] << " u" << i;
+			if (t == 0)
+				ss << " : hint_range(0.0, 1.0) = 0.5";
+			else if (t == 3)
+				ss << " : hint_color = vec4(1.0)";
+			ss << ";\n";
+		}
+
+		ss << "\nvoid fragment() {\n\tfloat sum = 0.0;\n";
+		for (int i = 0; i < count; i++) {
+			int t = i % 5;
+			if (t == 4)
+				ss << "\tsum += float(u" << i << ");\n";
+			else
+				ss << "\tsum += u" << i << swizzle[t] << ";\n";
+		}
+		ss << "\tCOLOR = texture(TEXTURE, UV) * (sum / " << count << ".0);\n}\n";
+
+		return ss.str();
+	}
+
+	// long chain of functions calling each other, each with nested branches and loops
+	std::string generateNesting(int functions, int depth)
+	{
+		std::stringstream ss;
+		ss << "shader_type canvas_item;\n\n";
+		ss << "float f0(float x) {\n\treturn x * 0.5;\n}\n\n";
+		for (int f = 1; f < functions; f++) {
+			ss << "float f" << f << "(float x) {\n";
+			for (int d = 0; d < depth; d++) {
+				std::string indent(d + 1, '\t');
+				if (d % 2 == 0)
+					ss << indent << "if (x > " << (d + 1) * 0.01f << ") {\n";
+				else
+					ss << indent << "for (int i" << d << " = 0; i" << d << " < 2; i" << d << "++) {\n";
+			}
+			ss << std::string(depth + 1, '\t') << "x = f" << f - 1 << "(x) + 0.1;\n";
+			for (int d = depth - 1; d >= 0; d--)
+				ss << std::string(d + 1, '\t') << "}\n";
+			ss << "\treturn x;\n}\n\n";
+		}
+		ss << "void fragment() {\n\tCOLOR = texture(TEXTURE, UV) * f" << functions - 1 << "(UV.x);\n}\n";
+
+		return ss.str();
+	}
+
+	bool loadCorpus(const std::string& dir, std::vector<Shader>& shaders)
+	{
+		std::error_code ec;
+		std::vector<ghc::filesystem::path> files;
+		for (const auto& entry : ghc::filesystem::directory_iterator(dir, ec))
+			if (entry.path().extension() == ".shader")
+				files.push_back(entry.path());
+		if (ec)
+			return false;
+
+		std::sort(files.begin(), files.end());
+		for (const auto& file : files) {
+			std::ifstream in(file.string(), std::ios::binary);
+			std::stringstream ss;
+			ss << in.rdbuf();
+			shaders.push_back({ file.stem().string(), ss.str() });
+		}
+
+		return true;
+	}
+
+	Result run(const Shader& shader, const Options& opts)
+	{
+		Result res;
+		res.Name = shader.Name;
+		res.Bytes = shader.Code.size();
+		res.Iterations = opts.Iterations;
+
+		for (int i = 0; i < opts.Warmup; i++) {
+			gd::GLSLOutput out;
+			gd::ShaderTranscompiler::Transcompile(shader.Code, out);
+			if (out.Error) {
+				res.Error = true;
+				res.ErrorMessage = out.ErrorMessage;
+				res.ErrorLine = out.ErrorLine;
+				return res;
+			}
+		}
+
+		double minMs = 1e30;
+		size_t allocs = 0, bytes = 0;
+		for (int i = 0; i < opts.Iterations; i++) {
+			size_t startCount = allocCount, startBytes = allocBytes, startLive = liveBytes;
+			peakBytes = liveBytes;
+
+			auto start = std::chrono::high_resolution_clock::now();
+			{
+				gd::GLSLOutput out;
+				gd::ShaderTranscompiler::Transcompile(shader.Code, out);
+			}
+			double ms = toMs(std::chrono::high_resolution_clock::now() - start);
+
+			allocs += allocCount - startCount;
+			bytes += allocBytes - startBytes;
+			res.PeakHeapBytes = std::max(res.PeakHeapBytes, peakBytes - startLive);
+
+			minMs = std::min(minMs, ms);
+			res.TotalMs += ms;
+		}
+
+		if (opts.Iterations > 0) {
+			res.MinMs = minMs;
+			res.AvgMs = res.TotalMs / opts.Iterations;
+			res.AllocsPerCompile = allocs / (double)opts.Iterations;
+			res.AllocBytesPerCompile = bytes / (double)opts.Iterations;
+		}
+		if (res.TotalMs > 0.0) {
+			res.ShadersPerSecond = opts.Iterations / (res.TotalMs / 1000.0);
+			res.BytesPerSecond = res.Bytes * (double)opts.Iterations / (res.TotalMs / 1000.0);
+		}
+
+		return res;
+	}
+
+	void writeJSON(FILE* f, const Options& opts, const std::vector<Result>& results, size_t peakRSS)
+	{
+		size_t totalBytes = 0, totalShaders = 0;
+		double totalMs = 0.0;
+
+		fprintf(f, "{\n");
+		fprintf(f, "\t\"tag\": \"%s\",\n", escapeJSON(opts.Tag).c_str());
+		fprintf(f, "\t\"iterations\": %d,\n", opts.Iterations);
+		fprintf(f, "\t\"warmup\": %d,\n", opts.Warmup);
+		fprintf(f, "\t\"shaders\": [\n");
+		for (size_t i = 0; i < results.size(); i++) {
+			const Result& r = results[i];
+			fprintf(f, "\t\t{\n");
+			fprintf(f, "\t\t\t\"name\": \"%s\",\n", escapeJSON(r.Name).c_str());
+			fprintf(f, "\t\t\t\"bytes\": %zu,\n", r.Bytes);
+			if (r.Error) {
+				fprintf(f, "\t\t\t\"error\": \"%s\",\n", escapeJSON(r.ErrorMessage).c_str());
+				fprintf(f, "\t\t\t\"error_line\": %d\n", r.ErrorLine);
+			} else {
+				fprintf(f, "\t\t\t\"min_ms\": %.6f,\n", r.MinMs);
+				fprintf(f, "\t\t\t\"avg_ms\": %.6f,\n", r.AvgMs);
+				fprintf(f, "\t\t\t\"shaders_per_second\": %.2f,\n", r.ShadersPerSecond);
+				fprintf(f, "\t\t\t\"bytes_per_second\": %.2f,\n", r.BytesPerSecond);
+				fprintf(f, "\t\t\t\"allocations_per_compile\": %.2f,\n", r.AllocsPerCompile);
+				fprintf(f, "\t\t\t\"allocated_bytes_per_compile\": %.2f,\n", r.AllocBytesPerCompile);
+				fprintf(f, "\t\t\t\"peak_heap_bytes\": %zu\n", r.PeakHeapBytes);
+
+				totalBytes += r.Bytes * r.Iterations;
+				totalShaders += r.Iterations;
+				totalMs += r.TotalMs;
+			}
+			fprintf(f, "\t\t}%s\n", i + 1 < results.size() ? "," : "");
+		}
+		fprintf(f, "\t],\n");
+
+		double seconds = totalMs / 1000.0;
+		fprintf(f, "\t\"total\": {\n");
+		fprintf(f, "\t\t\"shaders_per_second\": %.2f,\n", seconds > 0.0 ? totalShaders / seconds : 0.0);
+		fprintf(f, "\t\t\"bytes_per_second\": %.2f,\n", seconds > 0.0 ? totalBytes / seconds : 0.0);
+		fprintf(f, "\t\t\"peak_rss_bytes\": %zu\n", peakRSS);
+		fprintf(f, "\t}\n");
+		fprintf(f, "}\n");
+	}
+
+	void writeTable(const std::vector<Result>& results, size_t peakRSS)
+	{
+		printf("%-24s %10s %10s %10s %12s %12s %10s %12s\n", "shader", "bytes", "min ms", "avg ms", "shaders/s", "MB/s", "allocs", "peak KB");
+		for (const Result& r : results) {
+			if (r.Error) {
+				printf("%-24s %10zu   error: %s (line %d)\n", r.Name.c_str(), r.Bytes, r.ErrorMessage.c_str(), r.ErrorLine);
+				continue;
+			}
+			printf("%-24s %10zu %10.3f %10.3f %12.1f %12.2f %10.1f %12.1f\n", r.Name.c_str(), r.Bytes,
+				r.MinMs, r.AvgMs, r.ShadersPerSecond, r.BytesPerSecond / (1024.0 * 1024.0),
+				r.AllocsPerCompile, r.PeakHeapBytes / 1024.0);
+		}
+		printf("peak RSS: %.1f MB\n", peakRSS / (1024.0 * 1024.0));
+	}
+
+	void printUsage()
+	{
+		printf("usage: GodotShadersTranscompilerBench [options]\n");
+		printf("  --corpus DIR       directory with .shader files (default: %s)\n", GODOTSHADERS_BENCH_CORPUS);
+		printf("  --iterations N     timed compiles per shader (default: 200)\n");
+		printf("  --warmup N         untimed compiles per shader (default: 5)\n");
+		printf("  --json [FILE]      write the results as JSON to FILE or stdout\n");
+		printf("  --tag NAME         label stored in the JSON output (commit, version, ...)\n");
+	}
+
+	bool parseArgs(int argc, char** argv, Options& opts)
+	{
+		for (int i = 1; i < argc; i++) {
+			const char* arg = argv[i];
+			bool hasValue = i + 1 < argc;
+
+			if (strcmp(arg, "--corpus") == 0 && hasValue)
+				opts.Corpus = argv[++i];
+			else if (strcmp(arg, "--iterations") == 0 && hasValue)
+				opts.Iterations = std::max(1, atoi(argv[++i]));
+			else if (strcmp(arg, "--warmup") == 0 && hasValue)
+				opts.Warmup = std::max(0, atoi(argv[++i]));
+			else if (strcmp(arg, "--json") == 0) {
+				opts.JSON = true;
+				if (hasValue && strncmp(argv[i + 1], "--", 2) != 0)
+					opts.JSONPath = argv[++i];
+			} else if (strcmp(arg, "--tag") == 0 && hasValue)
+				opts.Tag = argv[++i];
+			else
+				return false;
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench::Options opts;
+	if (!bench::parseArgs(argc, argv, opts)) {
+		bench::printUsage();
+		return 1;
+	}
+
+	std::vector<bench::Shader> shaders;
+	if (!bench::loadCorpus(opts.Corpus, shaders))
+		fprintf(stderr, "Failed to read the corpus directory %s\n", opts.Corpus.c_str());
+
+	shaders.push_back({ "gen_uniforms_64", bench::generateUniforms(64) });
+	shaders.push_back({ "gen_uniforms_512", bench::generateUniforms(512) });
+	shaders.push_back({ "gen_nesting_16x8", bench::generateNesting(16, 8) });
+	shaders.push_back({ "gen_nesting_64x24", bench::generateNesting(64, 24) });
+
+	std::vector<bench::Result> results;
+	bool failed = false;
+	for (const auto& shader : shaders) {
+		results.push_back(bench::run(shader, opts));
+		failed |= results.back().Error;
+	}
+
+	size_t peakRSS = bench::getPeakRSS();
+
+	if (opts.JSON) {
+		FILE* f = stdout;
+		if (!opts.JSONPath.empty()) {
+			f = fopen(opts.JSONPath.c_str(), "w");
+			if (f == nullptr) {
+				fprintf(stderr, "Failed to open %s\n", opts.JSONPath.c_str());
+				return 1;
+			}
+		}
+
+		bench::writeJSON(f, opts, results, peakRSS);
+
+		if (f != stdout)
+			fclose(f);
+	}
+	if (!opts.JSON || !opts.JSONPath.empty())
+		bench::writeTable(results, peakRSS);
+
+	return failed ? 1 : 0;
+}
\ No newline at end of file
@@ -0,0 +1,147 @@
+shader_type canvas_item;
+render_mode blend_mix;
+
+uniform vec4 outline_color : hint_color = vec4(0.0, 0.0, 0.0, 1.0);
+uniform float outline_width : hint_range(0.0, 16.0) = 2.0;
+uniform vec4 glow_color : hint_color = vec4(1.0, 0.8, 0.2, 1.0);
+uniform float glow_strength : hint_range(0.0, 4.0) = 1.0;
+uniform float wave_amplitude = 0.02;
+uniform float wave_frequency = 12.0;
+uniform float wave_speed = 2.0;
+uniform sampler2D noise_texture : hint_white;
+uniform float dissolve : hint_range(0.0, 1.0) = 0.0;
+uniform vec4 dissolve_edge : hint_color = vec4(1.0, 0.4, 0.0, 1.0);
+uniform float edge_width : hint_range(0.0, 0.2) = 0.05;
+uniform float saturation : hint_range(0.0, 2.0) = 1.0;
+uniform float contrast : hint_range(0.0, 2.0) = 1.0;
+uniform float brightness : hint_range(-1.0, 1.0) = 0.0;
+uniform int posterize_levels = 0;
+uniform bool use_vignette = true;
+uniform float vignette_radius = 0.75;
+uniform float vignette_softness = 0.45;
+uniform mat3 color_matrix = mat3(vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0));
+
+varying vec2 world_pos;
+varying float wave_phase;
+
+const float PI = 3.14159265;
+const int BLUR_TAPS = 8;
+
+float luminance(vec3 c) {
+	return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+vec3 adjust_saturation(vec3 c, float s) {
+	float l = luminance(c);
+	return mix(vec3(l), c, s);
+}
+
+vec3 adjust_contrast(vec3 c, float k) {
+	return (c - 0.5) * k + 0.5;
+}
+
+vec3 posterize(vec3 c, int levels) {
+	if (levels <= 0) {
+		return c;
+	}
+	float l = float(levels);
+	return floor(c * l) / l;
+}
+
+float hash(vec2 p) {
+	return fract(sin(dot(p, vec2(127.1, 311.7))) * 43758.5453);
+}
+
+float value_noise(vec2 p) {
+	vec2 i = floor(p);
+	vec2 f = fract(p);
+	vec2 u = f * f * (3.0 - 2.0 * f);
+	float a = hash(i);
+	float b = hash(i + vec2(1.0, 0.0));
+	float c = hash(i + vec2(0.0, 1.0));
+	float d = hash(i + vec2(1.0, 1.0));
+	return mix(mix(a, b, u.x), mix(c, d, u.x), u.y);
+}
+
+float fbm(vec2 p) {
+	float v = 0.0;
+	float a = 0.5;
+	for (int i = 0; i < 5; i++) {
+		v += a * value_noise(p);
+		p *= 2.0;
+		a *= 0.5;
+	}
+	return v;
+}
+
+float outline_alpha(sampler2D tex, vec2 uv, vec2 pixel, float width) {
+	float a = 0.0;
+	for (int i = 0; i < BLUR_TAPS; i++) {
+		float angle = float(i) / float(BLUR_TAPS) * 2.0 * PI;
+		vec2 offset = vec2(cos(angle), sin(angle)) * pixel * width;
+		a = max(a, texture(tex, uv + offset).a);
+	}
+	return a;
+}
+
+vec4 glow(sampler2D tex, vec2 uv, vec2 pixel) {
+	vec4 sum = vec4(0.0);
+	float weight = 0.0;
+	for (int x = -2; x <= 2; x++) {
+		for (int y = -2; y <= 2; y++) {
+			float w = 1.0 / (1.0 + float(x * x + y * y));
+			sum += texture(tex, uv + vec2(float(x), float(y)) * pixel * 2.0) * w;
+			weight += w;
+		}
+	}
+	return sum / weight;
+}
+
+float vignette(vec2 uv) {
+	float d = distance(uv, vec2(0.5));
+	return smoothstep(vignette_radius, vignette_radius - vignette_softness, d);
+}
+
+void vertex() {
+	wave_phase = TIME * wave_speed + VERTEX.x * 0.01;
+	VERTEX.y += sin(wave_phase) * wave_amplitude * 100.0;
+	world_pos = VERTEX;
+}
+
+void fragment() {
+	vec2 uv = UV;
+	uv.x += sin(uv.y * wave_frequency + wave_phase) * wave_amplitude;
+
+	vec4 base = texture(TEXTURE, uv);
+
+	// outline
+	if (outline_width > 0.0 && base.a < 0.5) {
+		float a = outline_alpha(TEXTURE, uv, TEXTURE_PIXEL_SIZE, outline_width);
+		base = mix(base, outline_color, a * outline_color.a);
+	}
+
+	// glow
+	vec4 g = glow(TEXTURE, uv, TEXTURE_PIXEL_SIZE);
+	base.rgb += g.rgb * glow_color.rgb * glow_strength * (1.0 - base.a);
+
+	// dissolve
+	float n = texture(noise_texture, uv).r * 0.5 + fbm(world_pos * 0.05) * 0.5;
+	if (n < dissolve) {
+		discard;
+	} else if (n < dissolve + edge_width) {
+		base.rgb = mix(base.rgb, dissolve_edge.rgb, 1.0 - (n - dissolve) / edge_width);
+	}
+
+	// color grading
+	vec3 c = color_matrix * base.rgb;
+	c = adjust_saturation(c, saturation);
+	c = adjust_contrast(c, contrast);
+	c += brightness;
+	c = posterize(c, posterize_levels);
+
+	if (use_vignette) {
+		c *= vignette(SCREEN_UV);
+	}
+
+	COLOR = vec4(clamp(c, vec3(0.0), vec3(1.0)), base.a) * COLOR;
+}
@@ -0,0 +1,7 @@
+shader_type canvas_item;
+
+uniform vec4 tint : hint_color = vec4(1.0);
+
+void fragment() {
+	COLOR = texture(TEXTURE, UV) * tint;
+}
@@ -7,6 +7,7 @@
 
 #include "imgui/imgui.h"
 #include "GodotShaders.h"
+#include "Core/FrameStats.h"
 
 #ifdef WIN32
 # define FEXPORT __declspec(dllexport)
@@ -31,6 +32,24 @@ extern "C" {
 	FEXPORT const char* GetPluginName() {
 		return "GodotShaders";
 	}
+
+	// frame statistics for external tools, values are from the last finished frame
+	FEXPORT int GetFrameCounterCount() {
+		return (int)gd::FrameCounter::Count;
+	}
+	FEXPORT const char* GetFrameCounterName(int index) {
+		if (index < 0 || index >= (int)gd::FrameCounter::Count)
+			return nullptr;
+		return gd::FrameStats::GetName((gd::FrameCounter)index);
+	}
+	FEXPORT int GetFrameCounter(int index) {
+		if (index < 0 || index >= (int)gd::FrameCounter::Count)
+			return -1;
+		return gd::FrameStats::Instance().Get((gd::FrameCounter)index);
+	}
+	FEXPORT unsigned long long GetFrameIndex() {
+		return gd::FrameStats::Instance().GetFrameIndex();
+	}
 }
 
 #ifdef _WIN32
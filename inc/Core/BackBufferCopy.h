@@ -8,7 +8,12 @@ namespace gd
 		class BackBufferCopy : public PipelineItem
 		{
 		public:
-			BackBufferCopy() { Type = PipelineItemType::BackBufferCopy; }
+			BackBufferCopy();
+
+			char Snapshot[PIPELINE_ITEM_NAME_LENGTH]; // empty -> the default SCREEN_TEXTURE is copied again
+			int SnapshotSlot; // ResourceManager snapshot assigned for the current frame, -1 if nothing reads it
+
+			void ShowProperties();
 		};
 	}
 }
\ No newline at end of file
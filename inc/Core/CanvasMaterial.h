@@ -2,18 +2,36 @@
 #include <Core/Uniform.h>
 #include <Core/Settings.h>
 #include <Core/PipelineItem.h>
+#include <Core/ShaderCache.h>
+#include <Core/CompileQueue.h>
 #include <GodotShaderTranscompiler/ShaderTranscompiler.h>
 
 #include <glm/glm.hpp>
+#include <memory>
+#include <chrono>
 
 namespace gd
 {
 	namespace pipe
 	{
+		enum class SpriteDrawMode
+		{
+			Individual,	// one draw call per sprite
+			Batched,	// sprites are transformed on the CPU and merged into one vertex buffer
+			Instanced	// one instanced draw call, sprite data is stored in a per-instance buffer
+		};
+
 		class CanvasMaterial : public PipelineItem
 		{
 		public:
 			char ShaderPath[MAX_PATH_LENGTH];
+			SpriteDrawMode DrawMode;
+			bool UseTextureAtlas; // Batched & Instanced only
+			bool UseUniformBuffer; // store user uniforms in a std140 uniform block
+			bool LimitScreenCopy; // only copy the SCREEN_TEXTURE pixels around the sprites
+			int ScreenCopyMargin; // in pixels, for shaders that read SCREEN_TEXTURE outside of the sprite
+			char ScreenSnapshot[PIPELINE_ITEM_NAME_LENGTH]; // BackBufferCopy snapshot that SCREEN_TEXTURE reads, empty -> default
+			int ScreenSnapshotSlot; // assigned every frame by GodotShaders
 
 			CanvasMaterial();
 			~CanvasMaterial();
@@ -23,9 +41,24 @@ namespace gd
 			void ShowProperties();
 			void ShowVariableEditor();
 			void Compile();
-			void CompileFromSource(const char* filedata, int filesize);
+			std::string GetShaderFilePath(); // absolute path, empty if no shader is set
+			static std::string LoadShaderFile(const std::string& path); // can be called from any thread
+			void CompileFromSource(const char* filedata, int filesize, bool incremental = false); // transcompiles in the background, incremental -> skips edits that only touch comments & whitespace
+			void QueueCompileFromSource(const char* filedata, int filesize, bool incremental); // editor edits, only the last source of a burst is compiled
+			void WaitForCompile();
+			void Update(); // picks up the finished compile jobs, called every frame
+			inline bool IsCompiling() { return m_pending != nullptr || m_hasQueuedSource; }
+			inline bool HasProgram() { return m_shader != 0; }
 
 			void SetModelMatrix(glm::mat4 mat);
+			inline bool IsVertexTransformSkipped() { return m_glslData.SkipVertexTransform; }
+			inline bool IsScreenTextureUsed() { return !m_glslData.Error && m_glslData.SCREEN_TEXTURE; }
+			inline bool NeedsExactScreenTexture() { return IsScreenTextureUsed() && m_screenExact; }
+			inline bool IsInstanced() { return m_instanced; } // false if the shader couldn't be converted to the instanced variant
+			inline int GetBlendMode() { return m_glslData.BlendMode; }
+			inline unsigned int GetProgram() { return m_shader; }
+			bool GetBounds(glm::ivec4& bounds); // framebuffer pixels covered by the sprites, false -> unknown
+			bool HasSameState(CanvasMaterial* other); // same program, uniform values & textures -> one Bind() can draw both
 
 
 			inline const std::unordered_map<std::string, Uniform>& GetUniforms() { return m_uniforms; }
@@ -34,16 +67,68 @@ namespace gd
 				if (m_uniforms.count(name) == 0)
 					m_uniforms[name].Type = ShaderLanguage::TYPE_VOID;
 				m_uniforms[name].Value = val;
+				m_uniforms[name].Dirty = true;
 			}
 
 		private:
+			// user uniforms laid out in one contiguous buffer, rebuilt after each compile
+			struct UniformSlot
+			{
+				unsigned int Location;
+				ShaderLanguage::DataType Type;
+				int Components, Columns; // Columns = 1 for non-matrix types
+				unsigned int Offset, Size; // in m_uniformData
+				unsigned int MatrixStride; // distance between matrix columns
+				bool InBlock; // stored in the uniform buffer
+				Uniform* Source;
+			};
+			std::vector<UniformSlot> m_uniformLayout;
+			std::vector<char> m_uniformData;
+			std::vector<Uniform*> m_samplers;
+			unsigned int m_ubo;
+			void m_buildUniformLayout();
+			bool m_packUniform(const UniformSlot& slot, char* out);
+
+			bool m_getScreenRegion(glm::ivec4& region); // false -> whole screen is needed
+
+			// compile job, current program is used until it's done
+			struct PendingCompile
+			{
+				std::string Source, ProjectDir;
+				unsigned int Variant;
+				uint64_t TokenKey; // ShaderCache::GetTokenKey(), 0 if there is no source
+				bool HasSource, Instanced, UniformBuffer;
+				ShaderCache::Entry Data; // transcompiler output & final GLSL
+				ShaderCache::Program* Program; // != nullptr -> ready to use
+				bool IsLinking;
+				unsigned int VS, PS; // only valid while linking
+			};
+			std::shared_ptr<PendingCompile> m_pending;
+			std::shared_ptr<CompileQueue::Job> m_pendingJob;
+			static void m_transcompile(PendingCompile& data);
+			bool m_link(); // returns false while the driver is still compiling
+			void m_cancelCompile();
+			void m_applyCompile();
+			void m_addProgramMessages(); // messages that belong to m_program, they don't point at a line
+
+			// QueueCompileFromSource() waits until the editor stops sending new sources
+			std::string m_queuedSource;
+			bool m_hasQueuedSource, m_queuedIncremental;
+			std::chrono::steady_clock::time_point m_queuedTime;
+			void m_compileQueuedSource();
 
 			gd::GLSLOutput m_glslData;
 			std::unordered_map<std::string, Uniform> m_uniforms;
 
 			float m_vw, m_vh;
+			bool m_instanced;
+			int m_screenLevels; // blurred SCREEN_TEXTURE levels used by the shader, -1 -> all
+			bool m_screenExact; // SCREEN_TEXTURE is sampled with unscaled SCREEN_UV -> it can't be pooled
 
+			ShaderCache::Program* m_program; // shared with materials that use the same shader
+			uint64_t m_programTokenKey; // source that m_program was built from, 0 -> unknown or the editor has moved on
 			unsigned int m_shader, m_projMatrixLoc, m_modelMatrixLoc, m_timeLoc, m_pixelSizeLoc;
+			unsigned int m_screenUVScaleLoc, m_screenUVMaxLoc;
 			glm::mat4 m_projMat;
 			glm::mat4 m_modelMat;
 		};
@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+namespace gd
+{
+	// worker threads for the CPU side of shader compilation (no GL calls in the jobs!)
+	class CompileQueue
+	{
+	public:
+		static inline CompileQueue& Instance()
+		{
+			static CompileQueue queue;
+			return queue;
+		}
+
+		CompileQueue();
+		~CompileQueue();
+
+		class Job
+		{
+		public:
+			Job(const std::function<void()>& func) : m_func(func), m_finished(false), m_cancelled(false) { }
+
+			inline bool IsFinished() { return m_finished; }
+			inline void Cancel() { m_cancelled = true; } // skips the job if it hasn't started yet
+
+		private:
+			friend class CompileQueue;
+			std::function<void()> m_func;
+			std::atomic<bool> m_finished, m_cancelled;
+		};
+
+		std::shared_ptr<Job> Submit(const std::function<void()>& func);
+		void Wait(const std::shared_ptr<Job>& job); // helps with the queued jobs while waiting
+		void Shutdown(); // joins the workers, has to be called before the plugin is unloaded
+
+		inline int GetWorkerCount() { return m_workers.size(); }
+
+	private:
+		void m_start();
+		void m_work();
+		bool m_runNext(std::unique_lock<std::mutex>& lock);
+
+		std::vector<std::thread> m_workers;
+		std::deque<std::shared_ptr<Job>> m_jobs;
+		std::mutex m_mutex;
+		std::condition_variable m_jobAdded, m_jobFinished;
+		bool m_exit;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+namespace gd
+{
+	// work the plugin's render path issues per frame
+	enum class FrameCounter
+	{
+		PipelineItems,		// ExecutePipelineItem calls
+		DrawCalls,			// glDraw* & compute dispatches
+		ProgramBinds,		// only the calls that GLState didn't skip
+		TextureBinds,
+		FramebufferBinds,
+		UniformUploads,		// glUniform* calls & uniform buffer updates
+		ScreenCopies,		// ResourceManager::Copy calls that had to copy something
+		BlurPasses,			// SCREEN_TEXTURE blur draws/dispatches
+		Count
+	};
+
+	class FrameStats
+	{
+	public:
+		static inline FrameStats& Instance()
+		{
+			static FrameStats stats;
+			return stats;
+		}
+
+		FrameStats();
+
+		bool ShowOverlay;
+
+		void BeginFrame(); // current frame's counters become the last frame's counters
+		inline void Add(FrameCounter counter, int count = 1) { m_current[(int)counter] += count; }
+
+		// last finished frame
+		inline int Get(FrameCounter counter) { return m_last[(int)counter]; }
+		inline unsigned long long GetFrameIndex() { return m_frame; }
+		static const char* GetName(FrameCounter counter);
+
+		void ShowOverlayWindow();
+
+	private:
+		int m_current[(int)FrameCounter::Count];
+		int m_last[(int)FrameCounter::Count];
+		unsigned long long m_frame;
+	};
+}
\ No newline at end of file
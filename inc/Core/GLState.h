@@ -0,0 +1,64 @@
+#pragma once
+#include <Core/FrameStats.h>
+
+#define GL_STATE_TEXTURE_UNITS 32
+
+namespace gd
+{
+	// shadow copy of the GL state that the plugin touches, skips the calls that wouldn't change anything
+	// only trusted between Begin() and End(), SHADERed & ImGui change the state behind our back outside of that
+	class GLState
+	{
+	public:
+		static inline GLState& Instance()
+		{
+			static GLState state;
+			return state;
+		}
+
+		GLState();
+
+		void Begin(); // start of the plugin's part of the frame
+		void End();
+		void Invalidate(); // someone else changed the state -> forget everything
+		inline bool IsActive() { return m_active; }
+
+		void UseProgram(unsigned int prog);
+		void BindVertexArray(unsigned int vao);
+		void BindTexture(int unit, unsigned int tex); // GL_TEXTURE_2D
+		void ActiveTexture(int unit);
+		void SelectTexture(int unit, unsigned int tex); // BindTexture() + ActiveTexture(), use it before glTexParameter*() & glGetTexLevelParameter*()
+		void BindFramebuffer(unsigned int target, unsigned int fbo);
+		void Viewport(int x, int y, int w, int h);
+		void Enable(unsigned int cap, bool enable); // GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST
+		bool IsEnabled(unsigned int cap);
+		void BlendEquation(unsigned int mode);
+		void BlendFunc(unsigned int srcRGB, unsigned int dstRGB, unsigned int srcA, unsigned int dstA);
+
+		// current binding, asks the driver only if it isn't known yet -> use these to restore the state after a detour
+		unsigned int GetTexture(int unit);
+		unsigned int GetFramebuffer(unsigned int target); // GL_DRAW_FRAMEBUFFER or GL_READ_FRAMEBUFFER
+
+		// calls that reached the driver / calls that were skipped, last frame
+		inline int GetIssuedCount() { return m_lastIssued; }
+		inline int GetSkippedCount() { return m_lastSkipped; }
+
+	private:
+		bool m_active;
+		int m_issued, m_skipped;
+		int m_lastIssued, m_lastSkipped;
+
+		bool m_check(bool same, FrameCounter counter = FrameCounter::Count); // counts the call, returns true if it has to be issued
+
+		// -1 -> unknown
+		long long m_program, m_vao, m_drawFBO, m_readFBO;
+		long long m_textures[GL_STATE_TEXTURE_UNITS];
+		int m_activeUnit;
+		int m_viewport[4];
+		int m_blend, m_depthTest, m_cullFace, m_scissorTest;
+		long long m_blendEquation;
+		long long m_blendFunc[4];
+
+		int* m_getCap(unsigned int cap);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#define GPU_PROFILER_FRAMES 3 // results are read this many frames later -> no stalls
+#define GPU_PROFILER_HISTORY 256 // samples kept for min/avg/p99
+
+namespace gd
+{
+	// GPU time of the pipeline items, SCREEN_TEXTURE copies & blur levels
+	class GPUProfiler
+	{
+	public:
+		static inline GPUProfiler& Instance()
+		{
+			static GPUProfiler prof;
+			return prof;
+		}
+
+		GPUProfiler();
+		~GPUProfiler();
+
+		bool Enabled;
+
+		void BeginFrame(); // collects the results of an older frame
+		void EndFrame();
+
+		// scopes can be nested, the name of a nested scope is prefixed with its parent's name
+		void Begin(const char* name); // nothing is copied unless IsRecording()
+		void End();
+		inline bool IsRecording() { return m_inFrame; } // check it before building a name for Begin()
+
+		struct Stats
+		{
+			std::string Name;
+			int Depth;
+			float Last; // ms
+			float Min, Avg, P99;
+			int Samples;
+		};
+		// in the order the scopes were last executed
+		std::vector<Stats> GetStats();
+		bool ExportCSV(const std::string& path);
+		void Reset();
+
+	private:
+		struct Scope
+		{
+			std::string Name;
+			int Depth;
+			int StartQuery, EndQuery;
+		};
+		struct Frame
+		{
+			std::vector<unsigned int> Queries; // GL_TIMESTAMP, reused every few frames
+			int UsedQueries;
+			std::vector<Scope> Scopes;
+		};
+		Frame m_frames[GPU_PROFILER_FRAMES];
+		int m_frame;
+		bool m_inFrame;
+		std::vector<int> m_stack; // open scopes in the current frame
+		int m_getQuery();
+		void m_collect(Frame& frame);
+
+		struct History
+		{
+			int Depth, Order;
+			float Last;
+			std::vector<float> Samples; // ring buffer
+			int Next;
+		};
+		std::unordered_map<std::string, History> m_history;
+	};
+}
\ No newline at end of file
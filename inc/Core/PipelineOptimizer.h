@@ -0,0 +1,52 @@
+#pragma once
+#include <Core/PipelineItem.h>
+
+#include <vector>
+#include <unordered_map>
+
+namespace gd
+{
+	namespace pipe { class CanvasMaterial; }
+
+	// reorders runs of materials whose draw order doesn't change the result so that
+	// program, texture & blend switches are minimized, materials with the same state are drawn with one Bind()
+	class PipelineOptimizer
+	{
+	public:
+		PipelineOptimizer();
+
+		bool Enabled;
+
+		// materials in Materials[1..] are drawn with Materials[0]'s Bind()
+		struct DrawGroup
+		{
+			std::vector<pipe::CanvasMaterial*> Materials;
+		};
+
+		void Build(const std::vector<PipelineItem*>& items); // once per frame, before the items are executed
+		void Clear();
+
+		// nullptr -> execute the item as usual
+		// otherwise the item is a part of a reordered run, the run is returned for the first item that's executed
+		// and an empty list for the others (they were already drawn)
+		const std::vector<DrawGroup>* GetRun(PipelineItem* item);
+
+		inline int GetReorderedCount() { return m_reordered; }
+		inline int GetMergedCount() { return m_merged; }
+
+	private:
+		struct Run
+		{
+			std::vector<DrawGroup> Groups;
+			bool Drawn;
+		};
+		std::vector<Run> m_runs;
+		std::unordered_map<PipelineItem*, int> m_itemRun;
+		std::vector<DrawGroup> m_empty;
+
+		int m_reordered, m_merged;
+
+		bool m_canReorder(pipe::CanvasMaterial* mat);
+		void m_buildRun(const std::vector<pipe::CanvasMaterial*>& mats);
+	};
+}
\ No newline at end of file
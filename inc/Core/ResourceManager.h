@@ -1,9 +1,35 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <glm/glm.hpp>
 
 namespace gd
 {
+	// how the blurred SCREEN_TEXTURE levels are generated
+	enum class DownsampleMode
+	{
+		Fragment,		// horizontal & vertical pass, two draw calls per level
+		FusedFragment,	// both passes in one draw call per level
+		Compute			// one compute dispatch per level (GL 4.3)
+	};
+
+	// SCREEN_TEXTURE storage, RGBA8 clamps HDR colors
+	enum class ScreenTextureFormat
+	{
+		RGBA8,
+		RGB10_A2,
+		R11F_G11F_B10F,	// no alpha channel
+		RGBA16F
+	};
+
+	// how the color buffer is copied to the first SCREEN_TEXTURE level
+	enum class ScreenCopyMethod
+	{
+		Shader,		// full screen quad
+		Blit,		// glBlitFramebuffer
+		CopyImage	// glCopyImageSubData (GL 4.3 / ARB_copy_image)
+	};
+
 	class ResourceManager
 	{
 	public:
@@ -17,15 +43,38 @@ namespace gd
 		~ResourceManager();
 
 		unsigned int EmptyTexture, BlackTexture, WhiteTexture;
-		bool CopiedScreenTexture;
+		DownsampleMode Downsample;
+		inline bool IsComputeSupported() { return m_computeBlurShader != 0; }
+		bool FastScreenCopy; // blit/copy the color buffer instead of drawing it when the formats match
+
+		ScreenCopyMethod GetScreenCopyMethod(unsigned int colorBuffer);
+		std::string BenchmarkScreenCopy(unsigned int colorBuffer, unsigned int currentFBO, int iterations = 100);
+
+		inline ScreenTextureFormat GetScreenTextureFormat() { return m_format; }
+		void SetScreenTextureFormat(ScreenTextureFormat fmt);
+		std::string BenchmarkScreenFormats(unsigned int colorBuffer, unsigned int currentFBO, int iterations = 50);
 
 		void ResizeResources(int w, int h);
-		void Copy(unsigned int colorBuffer, unsigned int currentFBO);
+		// levels = number of blurred mip levels the shader samples, -1 -> all of them
+		// region = framebuffer pixels the shader reads (xy = min, zw = max), nullptr -> whole screen
+		// snapshot = 0 -> default SCREEN_TEXTURE, others are captured by the named BackBufferCopy items
+		void Copy(unsigned int colorBuffer, unsigned int currentFBO, int levels = -1, const glm::ivec4* region = nullptr, int snapshot = 0);
+
+		// snapshots are pooled, a slot can be reused once nothing reads it anymore
+		int AcquireSnapshot();
+		void ReleaseSnapshot(int snapshot);
+		void ReleaseSnapshots(); // every snapshot except the default one
+		void InvalidateSnapshot(int snapshot = 0); // next Copy() will copy the color buffer again
+		void CaptureSnapshot(int snapshot, unsigned int colorBuffer, unsigned int currentFBO);
 
 		inline const std::string& GetDefaultCanvasVertexShader() { return m_canvasVS; }
+		inline const std::string& GetDefaultCanvasInstancedVertexShader() { return m_canvasInstancedVS; }
 		inline const std::string& GetDefaultCanvasPixelShader() { return m_canvasPS; }
 
-		inline unsigned int SCREEN_TEXTURE() { return m_mipmapData[0].Color; }
+		inline unsigned int SCREEN_TEXTURE(int snapshot = 0) { return m_snapshots[snapshot].Mipmaps.Color; }
+		glm::vec2 GetScreenUVScale(); // SCREEN_UV -> texture coordinates, the texture can be bigger than the viewport
+		glm::vec2 GetScreenUVMax(); // last visible pixel in texture coordinates
+		void SetExactScreenSize(bool exact); // true -> SCREEN_TEXTURE isn't pooled, for shaders that sample it with unscaled SCREEN_UV
 
 		struct MipmapSize
 		{
@@ -34,22 +83,55 @@ namespace gd
 		};
 
 	private:
-		std::string m_canvasVS, m_canvasPS;
+		std::string m_canvasVS, m_canvasPS, m_canvasInstancedVS;
 
 		unsigned int m_mipmapDepth;
 		struct MipmapData
 		{
 			unsigned int Color;
-			std::vector<MipmapSize> Sizes;
+			std::vector<MipmapSize> Sizes; // visible part of each level
+			std::vector<MipmapSize> Pool; // allocated size of each level
 			unsigned int Levels;
-		} m_mipmapData[2];
+		} m_blurMipmaps; // intermediate texture for the two pass blur
+		int m_poolWidth, m_poolHeight;
+		bool m_exactScreenSize;
+
+		struct Snapshot
+		{
+			Snapshot() : CopiedLevels(0), Copied(false), InUse(false) { Mipmaps.Color = 0; Mipmaps.Levels = 0; }
+
+			MipmapData Mipmaps;
+			std::vector<glm::ivec4> CopiedRegions; // up to date pixels of each level
+			int CopiedLevels; // blurred levels that are up to date in this copy
+			bool Copied;
+			bool InUse;
+		};
+		std::vector<Snapshot> m_snapshots; // [0] -> default SCREEN_TEXTURE
+		int m_snapshot; // snapshot the blur passes work on
+		std::vector<glm::ivec4> m_requiredRegions; // Copy() scratch, one rect per level, sized in m_createMipmaps()
 
 		unsigned int m_copyShader, m_horizontalBlurShader, m_verticalBlurShader;
 		unsigned int m_hblurPixelSizeUniform, m_vblurPixelSizeUniform, m_quadVAO, m_quadVBO;
+		unsigned int m_hblurLodUniform, m_vblurLodUniform, m_hblurUVMaxUniform, m_vblurUVMaxUniform;
+		unsigned int m_fusedBlurShader, m_fusedBlurPixelSizeUniform, m_fusedBlurLodUniform, m_fusedBlurUVMaxUniform;
+		unsigned int m_computeBlurShader, m_computeBlurLodUniform, m_computeBlurRegionUniform, m_computeBlurUVMaxUniform;
+		glm::vec2 m_getUVMax(const MipmapData& mips, int level);
+		void m_createComputeBlur(); // has to be recreated when the format changes
+		void m_downsample(int level, const glm::ivec4& rect); // level -> level + 1
+		void m_downsampleFused(int level, const glm::ivec4& rect);
+		void m_downsampleCompute(int level, const glm::ivec4& rect);
 
 		void m_createMipmapResources();
 		void m_createMipmaps(int rtw, int rth);
+		void m_allocateMipmaps(int poolW, int poolH); // only called when the viewport doesn't fit in the pool
+		void m_allocateLevels(MipmapData& data, int w, int h, bool depth);
+		void m_setVisibleSize(MipmapData& data, int w, int h);
 		void m_copyScreen();
+		void m_copyRegion(ScreenCopyMethod method, unsigned int colorBuffer, const glm::ivec4& rect);
+		unsigned int m_copySource; // color buffer that m_copySourceMatches was checked for
+		bool m_copySourceMatches; // same size as the first level
+		int m_copySourceFormat;
+		ScreenTextureFormat m_format;
 
 		int m_rtw, m_rth;
 		
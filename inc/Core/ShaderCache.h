@@ -0,0 +1,65 @@
+#pragma once
+#include <GodotShaderTranscompiler/ShaderTranscompiler.h>
+
+#include <string>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace gd
+{
+	// stores transcompiled shaders and linked program binaries in the project directory
+	// and shares linked programs between materials that use the same source
+	class ShaderCache
+	{
+	public:
+		static inline ShaderCache& Instance()
+		{
+			static ShaderCache cache;
+			return cache;
+		}
+
+		ShaderCache();
+		~ShaderCache();
+
+		struct Entry
+		{
+			GLSLOutput Output;
+			std::string Vertex, Fragment; // final GLSL (after the instancing & uniform block changes)
+			bool Instanced;
+			unsigned int Program; // 0 -> no program binary or driver rejected it
+		};
+
+		// variant = flags that change the generated GLSL (draw mode, uniform buffer, ...)
+		bool Load(const std::string& projectDir, const std::string& source, unsigned int variant, Entry& out);
+		void Save(const std::string& projectDir, const std::string& source, unsigned int variant, const Entry& entry);
+
+		// linked program, reference counted
+		struct Program
+		{
+			Entry Data;
+			std::string Source;
+			unsigned int Variant;
+			uint64_t Key;
+			int References;
+			bool Shared; // other materials can Acquire() it
+			void* LastUser; // material whose uniform values are currently stored in the program
+		};
+
+		// returns nullptr if no material uses this source at the moment
+		Program* Acquire(const std::string& source, unsigned int variant);
+		// takes the ownership of entry.Program
+		Program* Create(const std::string& source, unsigned int variant, const Entry& entry, bool share);
+		void Release(Program* prog);
+
+		// ignores comments & whitespace -> same key means the transcompiler would produce the same output
+		static uint64_t GetTokenKey(const std::string& source, unsigned int variant);
+
+	private:
+		uint64_t m_getKey(const std::string& source, unsigned int variant);
+		const std::string& m_getDriverString();
+		std::string m_getFilename(const std::string& projectDir, const std::string& source, unsigned int variant);
+
+		std::string m_driver;
+		std::unordered_map<uint64_t, Program*> m_programs;
+	};
+}
\ No newline at end of file
@@ -20,6 +20,8 @@ namespace gd
 
 			inline glm::mat4 GetMatrix() { return m_matrix; }
 			inline const std::string& GetTexture() { return m_texName; }
+			inline unsigned int GetTextureID() { return m_texID; }
+			inline const CanvasVertex* GetVertices() { return m_verts; }
 			inline void SetPosition(glm::vec2 pos) { m_pos = pos; m_buildMatrix(); }
 			inline void SetSize(glm::vec2 pos) { m_size = pos; m_buildVBO(); }
 			inline void SetFlipHorizontal(bool t) { m_flipH = t; m_buildVBO(); }
@@ -0,0 +1,42 @@
+#pragma once
+#include <Core/Sprite.h>
+#include <Core/CanvasVertex.h>
+
+#include <vector>
+
+namespace gd
+{
+	class SpriteBatch
+	{
+	public:
+		static inline SpriteBatch& Instance()
+		{
+			static SpriteBatch batch;
+			return batch;
+		}
+
+		SpriteBatch();
+		~SpriteBatch();
+
+		// transformVertices = false -> sprite's matrix is ignored (SKIP_VERTEX_TRANSFORM)
+		// useAtlas = true -> sprite textures are packed into TextureAtlas and UVs are remapped
+		void Begin(bool transformVertices, bool useAtlas = false);
+		void Add(pipe::Sprite* sprite);
+		void End();
+
+	private:
+		struct Group
+		{
+			unsigned int Texture;
+			int First, Count;
+		};
+
+		bool m_transform, m_atlas;
+		std::vector<CanvasVertex> m_verts;
+		std::vector<Group> m_groups;
+
+		void m_createBuffers();
+		unsigned int m_vao, m_vbo;
+		size_t m_capacity; // in vertices
+	};
+}
\ No newline at end of file
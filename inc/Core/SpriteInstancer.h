@@ -0,0 +1,59 @@
+#pragma once
+#include <Core/Sprite.h>
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+namespace gd
+{
+	// per-instance attributes, locations 3 to 6 in the instanced vertex shader
+	struct SpriteInstance
+	{
+		glm::vec2 Position; // center of the sprite
+		glm::vec2 Size;
+		glm::vec4 Color;
+		float Rotation; // in radians
+		float Flip;		// bit 0 -> horizontal, bit 1 -> vertical
+		glm::vec4 UVRect; // xy = offset, zw = scale (TextureAtlas)
+	};
+
+	class SpriteInstancer
+	{
+	public:
+		static inline SpriteInstancer& Instance()
+		{
+			static SpriteInstancer inst;
+			return inst;
+		}
+
+		SpriteInstancer();
+		~SpriteInstancer();
+
+		// transformVertices = false -> sprite's position & rotation are ignored (SKIP_VERTEX_TRANSFORM)
+		// useAtlas = true -> sprite textures are packed into TextureAtlas
+		void Begin(bool transformVertices, bool useAtlas = false);
+		void Add(pipe::Sprite* sprite);
+		void End();
+
+		// turns a canvas item vertex shader into one that reads sprite data from the instance attributes
+		// returns an empty string if the shader doesn't have the expected inputs
+		static std::string CreateInstancedVertexShader(const std::string& vs);
+
+	private:
+		struct Group
+		{
+			unsigned int Texture;
+			int First, Count;
+		};
+
+		bool m_transform, m_atlas;
+		std::vector<SpriteInstance> m_instances;
+		std::vector<Group> m_groups;
+
+		void m_createBuffers();
+		void m_setInstanceOffset(int first);
+		unsigned int m_vao, m_quadVBO, m_instanceVBO;
+		size_t m_capacity; // in instances
+	};
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <unordered_map>
+
+namespace gd
+{
+	// packs RGBA8 sprite textures into a few big textures so that sprites with different textures can share a draw call
+	class TextureAtlas
+	{
+	public:
+		static inline TextureAtlas& Instance()
+		{
+			static TextureAtlas atlas;
+			return atlas;
+		}
+
+		TextureAtlas();
+		~TextureAtlas();
+
+		// returns the atlas page that contains tex (packing it if needed) and its UV rectangle (xy = offset, zw = scale)
+		// returns tex itself and the full UV rectangle if tex can't be packed
+		unsigned int Map(unsigned int tex, glm::vec4& uvRect);
+
+		// re-upload a single texture (its contents or size changed), other textures stay where they are
+		void Refresh(unsigned int tex);
+
+		void NewFrame();
+		void Clear();
+
+	private:
+		struct Shelf
+		{
+			int Y, Height, X;
+		};
+		struct Page
+		{
+			unsigned int Texture, FBO;
+			std::vector<Shelf> Shelves;
+			int LastUsed; // frame
+		};
+		struct Entry
+		{
+			int Page;
+			int X, Y, Width, Height; // texels of the texture itself, the padding around them is a copy of its edges
+		};
+
+		std::vector<Page> m_pages;
+		std::unordered_map<unsigned int, Entry> m_entries;
+		std::unordered_map<unsigned int, bool> m_rejected; // textures with unsupported format or size
+		std::unordered_map<unsigned int, bool> m_overflowed; // didn't fit, drawn without the atlas until a page is freed
+
+		bool m_allocate(int w, int h, Entry& out);
+		bool m_allocateInPage(int page, int w, int h, Entry& out);
+		void m_createPage();
+		void m_freePage(int page);
+		void m_copy(unsigned int tex, const Entry& entry);
+
+		bool m_overflow;
+		int m_frame;
+		unsigned int m_readFBO;
+	};
+}
\ No newline at end of file
@@ -6,9 +6,10 @@ namespace gd
 {
 	struct Uniform // TODO: move this to a separate file
 	{
-		unsigned int Location;
+		unsigned int Location; // uniform location or texture unit for samplers
 		ShaderLanguage::DataType Type;
 		std::vector<ShaderLanguage::ConstantNode::Value> Value;
+		bool Dirty; // Value changed -> upload it on the next CanvasMaterial::Bind()
 
 
 		ShaderLanguage::ShaderNode::Uniform::Hint HintType;
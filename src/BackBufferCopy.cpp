@@ -0,0 +1,28 @@
+#include <Core/BackBufferCopy.h>
+
+#include <imgui/imgui.h>
+#include <string.h>
+
+namespace gd
+{
+	namespace pipe
+	{
+		BackBufferCopy::BackBufferCopy()
+		{
+			Type = PipelineItemType::BackBufferCopy;
+			memset(Snapshot, 0, sizeof(char) * PIPELINE_ITEM_NAME_LENGTH);
+			SnapshotSlot = -1;
+		}
+		void BackBufferCopy::ShowProperties()
+		{
+			ImGui::Text("Snapshot:");
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Leave empty to make the next SCREEN_TEXTURE read copy the screen again.\nNamed snapshots keep this copy for the materials that select it.");
+			ImGui::SameLine();
+			ImGui::PushItemWidth(-1);
+			if (ImGui::InputText("##gd_bbc_snapshot", Snapshot, PIPELINE_ITEM_NAME_LENGTH))
+				Owner->ModifyProject(Owner->Project);
+			ImGui::PopItemWidth();
+		}
+	}
+}
\ No newline at end of file
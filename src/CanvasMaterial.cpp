@@ -1,5 +1,11 @@
 #include <Core/CanvasMaterial.h>
 #include <Core/ResourceManager.h>
+#include <Core/SpriteInstancer.h>
+#include <Core/Sprite.h>
+#include <Core/ShaderCache.h>
+#include <Core/CompileQueue.h>
+#include <Core/GLState.h>
+#include <Core/FrameStats.h>
 #include <PluginAPI/Plugin.h>
 #include <UI/UIHelper.h>
 #include "../GodotShaders.h"
@@ -10,6 +16,11 @@
 #include <string.h>
 #include <fstream>
 #include <string>
+#include <regex>
+#include <unordered_map>
+#include <mutex>
+#include <cmath>
+#include <cfloat>
 
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -22,6 +33,10 @@
 #endif
 
 #define BUTTON_SPACE_LEFT -40 * Owner->GetDPI()
+#define USER_UNIFORM_BLOCK_NAME "GodotUserUniforms"
+#define USER_UNIFORM_BLOCK_BINDING 0
+#define MAX_UNIFORM_SLOT_SIZE 64 // mat4, std140 column stride
+#define COMPILE_QUEUE_DELAY 200 // ms without edits before a queued editor source is compiled
 
 std::string LoadFile(const std::string& file)
 {
@@ -38,13 +53,193 @@ std::string LoadFile(const std::string& file)
 
 namespace gd
 {
+	// the Godot parser/compiler code keeps static tables & singletons that were never meant to be shared between
+	// threads -> only one Transcompile() at a time, the GLSL post-processing still runs in parallel
+	std::mutex transcompileMutex;
+
+	// removes the declarations of the given uniforms in one pass, decls receives their GLSL types
+	void extractUniformDecls(std::string& code, std::unordered_map<std::string, std::string>& decls)
+	{
+		static const std::regex declRegex("uniform\\s+((highp|mediump|lowp)\\s+)?(\\w+)\\s+m_(\\w+)\\s*;");
+
+		std::string ret;
+		std::string::const_iterator last = code.cbegin();
+		bool removed = false;
+		for (auto it = std::sregex_iterator(code.cbegin(), code.cend(), declRegex); it != std::sregex_iterator(); it++) {
+			auto decl = decls.find(it->str(4));
+			if (decl == decls.end())
+				continue;
+
+			if (!removed)
+				ret.reserve(code.size());
+			removed = true;
+
+			ret.append(last, (*it)[0].first);
+			last = (*it)[0].second;
+			decl->second = it->str(3);
+		}
+
+		if (!removed)
+			return;
+
+		ret.append(last, code.cend());
+		code = std::move(ret);
+	}
+
+	// moves the user uniform declarations from both shaders into one std140 uniform block
+	void moveUniformsToBlock(const GLSLOutput& data, std::string& vs, std::string& ps)
+	{
+		// one scan per shader instead of building & running a regex for each uniform
+		std::unordered_map<std::string, std::string> decls;
+		for (const auto& uniform : data.Uniforms)
+			if (!ShaderLanguage::is_sampler_type(uniform.second.type))
+				decls[uniform.first] = "";
+
+		if (decls.empty())
+			return;
+
+		extractUniformDecls(vs, decls);
+		extractUniformDecls(ps, decls);
+
+		std::string members = "";
+		for (const auto& uniform : data.Uniforms) {
+			auto decl = decls.find(uniform.first);
+			if (decl != decls.end() && !decl->second.empty())
+				members += "\t" + decl->second + " m_" + uniform.first + ";\n";
+		}
+
+		if (members.empty())
+			return;
+
+		static const std::regex versionRegex("#version[^\\n]*\\n");
+		std::string block = "layout(std140) uniform " USER_UNIFORM_BLOCK_NAME "\n{\n" + members + "};\n";
+		vs = std::regex_replace(vs, versionRegex, "$&" + block, std::regex_constants::format_first_only);
+		ps = std::regex_replace(ps, versionRegex, "$&" + block, std::regex_constants::format_first_only);
+	}
+
+	// SCREEN_TEXTURE is pooled and can be bigger than the viewport -> SCREEN_UV has to be scaled when sampling it
+	const char* SCREEN_TEXTURE_HELPERS = R"(
+uniform vec2 gd_screen_uv_scale;
+uniform vec2 gd_screen_uv_max;
+vec4 gd_texture(sampler2D s, vec2 uv) { return texture(s, min(uv * gd_screen_uv_scale, gd_screen_uv_max)); }
+vec4 gd_textureLod(sampler2D s, vec2 uv, float lod) { return textureLod(s, min(uv * gd_screen_uv_scale, gd_screen_uv_max), lod); }
+ivec2 gd_textureSize(sampler2D s, int lod) { return max(ivec2(vec2(textureSize(s, lod)) * gd_screen_uv_scale), ivec2(1)); }
+)";
+	const char* SCREEN_TEXTURE_BIAS_HELPER = R"(vec4 gd_texture(sampler2D s, vec2 uv, float bias) { return texture(s, min(uv * gd_screen_uv_scale, gd_screen_uv_max), bias); }
+)";
+	void remapScreenTexture(std::string& code, bool isFragment)
+	{
+		// texelFetch() doesn't need this since the visible part starts at (0,0)
+		static const std::regex callRegex("\\b(texture|textureLod|textureSize)(\\s*\\(\\s*screen_texture\\b)");
+		if (!std::regex_search(code, callRegex))
+			return;
+
+		std::string helpers = SCREEN_TEXTURE_HELPERS;
+		if (isFragment)
+			helpers += SCREEN_TEXTURE_BIAS_HELPER; // bias is only allowed in fragment shaders
+
+		code = std::regex_replace(code, callRegex, "gd_$1$2");
+
+		static const std::regex versionRegex("#version[^\\n]*\\n");
+		code = std::regex_replace(code, versionRegex, "$&" + helpers, std::regex_constants::format_first_only);
+	}
+
+	// true if the GLSL code reads SCREEN_TEXTURE in a way that remapScreenTexture() didn't scale
+	// (passed to a function, textureGrad(), textureProj(), textureOffset(), ...)
+	bool hasUnscaledScreenTextureReads(const std::string& code)
+	{
+		static const std::regex useRegex("\\bscreen_texture\\b");
+		static const std::regex scaledRegex("\\b(gd_texture|gd_textureLod|gd_textureSize|texelFetch)\\s*\\(\\s*$");
+		static const std::regex declRegex("uniform\\s+((highp|mediump|lowp)\\s+)?sampler2D\\s*$");
+
+		for (auto it = std::sregex_iterator(code.begin(), code.end(), useRegex); it != std::sregex_iterator(); it++) {
+			size_t start = it->position();
+			size_t beforeStart = start > 128 ? start - 128 : 0;
+			std::string before = code.substr(beforeStart, start - beforeStart);
+
+			if (!std::regex_search(before, declRegex) && !std::regex_search(before, scaledRegex))
+				return true;
+		}
+
+		return false;
+	}
+
+	// number of blurred SCREEN_TEXTURE levels the GLSL code samples, -1 if it can't be determined
+	int getScreenTextureLevels(const std::string& code)
+	{
+		static const std::regex useRegex("\\bscreen_texture\\b");
+		static const std::regex callRegex("\\b(?:gd_)?(texture|textureLod|texelFetch|textureSize)\\s*\\(\\s*$");
+		static const std::regex declRegex("uniform\\s+((highp|mediump|lowp)\\s+)?sampler2D\\s*$");
+		static const std::regex lodRegex("^\\s*([0-9]*\\.?[0-9]+)([eE][-+]?[0-9]+)?[fF]?\\s*$");
+
+		int levels = 0;
+		for (auto it = std::sregex_iterator(code.begin(), code.end(), useRegex); it != std::sregex_iterator(); it++) {
+			size_t start = it->position();
+			size_t beforeStart = start > 128 ? start - 128 : 0;
+			std::string before = code.substr(beforeStart, start - beforeStart);
+
+			if (std::regex_search(before, declRegex))
+				continue;
+
+			std::smatch call;
+			if (!std::regex_search(before, call, callRegex))
+				return -1; // passed to a function, assigned, ... -> could be sampled at any level
+
+			std::string func = call.str(1);
+			if (func == "textureSize")
+				continue;
+
+			// split the arguments
+			std::vector<std::string> args(1);
+			int depth = 0;
+			for (size_t i = start; i < code.size(); i++) {
+				char c = code[i];
+				if (c == '(') depth++;
+				else if (c == ')' && depth-- == 0) break;
+				else if (c == ',' && depth == 0) {
+					args.push_back("");
+					continue;
+				}
+				args.back() += c;
+			}
+
+			if (func == "texture") {
+				if (args.size() > 2)
+					return -1; // bias
+				continue; // plain back-buffer read
+			}
+
+			// textureLod & texelFetch -> the LOD has to be a constant
+			std::smatch lod;
+			if (args.size() < 3 || !std::regex_match(args[2], lod, lodRegex))
+				return -1;
+			levels = std::max<int>(levels, (int)std::ceil(std::stof(lod.str(1) + lod.str(2))));
+		}
+
+		return levels;
+	}
+
 	namespace pipe
 	{
 		CanvasMaterial::CanvasMaterial()
 		{
 			Type = PipelineItemType::CanvasMaterial;
 			memset(ShaderPath, 0, sizeof(char) * MAX_PATH_LENGTH);
+			DrawMode = SpriteDrawMode::Individual;
+			UseTextureAtlas = false;
+			UseUniformBuffer = false;
+			LimitScreenCopy = false;
+			ScreenCopyMargin = 16;
+			memset(ScreenSnapshot, 0, sizeof(char) * PIPELINE_ITEM_NAME_LENGTH);
+			ScreenSnapshotSlot = 0;
+			m_ubo = 0;
+			m_instanced = false;
+			m_screenLevels = -1;
+			m_screenExact = false;
 			m_shader = 0;
+			m_program = nullptr;
+			m_programTokenKey = 0;
+			m_hasQueuedSource = m_queuedIncremental = false;
 			m_vw = m_vh = 1.0f;
 			m_modelMat = m_projMat = glm::mat4(1.0f);
 			m_uniforms.clear();
@@ -52,8 +247,11 @@ namespace gd
 		}
 		CanvasMaterial::~CanvasMaterial()
 		{
-			if (m_shader != 0)
-				glDeleteShader(m_shader);
+			m_cancelCompile();
+			if (m_program != nullptr)
+				ShaderCache::Instance().Release(m_program);
+			if (m_ubo != 0)
+				glDeleteBuffers(1, &m_ubo);
 		}
 		void CanvasMaterial::SetViewportSize(float w, float h)
 		{
@@ -66,77 +264,120 @@ namespace gd
 			// bind shaders
 			if (!m_glslData.Error && m_glslData.SCREEN_TEXTURE)
 			{
-				ResourceManager::Instance().Copy(((gd::GodotShaders*)Owner)->GetColorBuffer(), ((gd::GodotShaders*)Owner)->GetFBO());
+				glm::ivec4 region;
+				bool hasRegion = LimitScreenCopy && m_getScreenRegion(region);
+				ResourceManager::Instance().Copy(((gd::GodotShaders*)Owner)->GetColorBuffer(), ((gd::GodotShaders*)Owner)->GetFBO(), m_screenLevels, hasRegion ? &region : nullptr, ScreenSnapshotSlot);
 
-				glUseProgram(m_shader);
-				glActiveTexture(GL_TEXTURE0 + 1);
-				glBindTexture(GL_TEXTURE_2D, ResourceManager::Instance().SCREEN_TEXTURE());
-				glUniform1i(glGetUniformLocation(m_shader, "screen_texture"), 1);
+				GLState::Instance().UseProgram(m_shader);
+				GLState::Instance().BindTexture(1, ResourceManager::Instance().SCREEN_TEXTURE(ScreenSnapshotSlot));
 
 				glUniform2f(m_pixelSizeLoc, 1.0f / m_vw, 1.0f/m_vh);
+				glUniform2fv(m_screenUVScaleLoc, 1, glm::value_ptr(ResourceManager::Instance().GetScreenUVScale()));
+				glUniform2fv(m_screenUVMaxLoc, 1, glm::value_ptr(ResourceManager::Instance().GetScreenUVMax()));
+				FrameStats::Instance().Add(FrameCounter::UniformUploads, 3);
 			}
 
-			glUseProgram(m_shader);
+			GLState::Instance().UseProgram(m_shader);
 
+			// program is shared with other materials -> they could have overwritten our values
+			if (m_program != nullptr && m_program->LastUser != this) {
+				m_program->LastUser = this;
+				for (const auto& slot : m_uniformLayout)
+					if (!slot.InBlock)
+						slot.Source->Dirty = true;
+			}
+
+			int uploads = 1; // projection matrix
 			glUniformMatrix4fv(m_projMatrixLoc, 1, GL_FALSE, glm::value_ptr(m_projMat));
 
-			if (m_glslData.TIME)
+			if (m_glslData.TIME) {
 				glUniform1f(m_timeLoc, Owner->GetTime());
+				uploads++;
+			}
+
+			// user uniforms -> only upload the values that changed since the last Bind()
+			size_t blockStart = m_uniformData.size(), blockEnd = 0;
+			for (const auto& slot : m_uniformLayout) {
+				if (!slot.Source->Dirty)
+					continue;
+				slot.Source->Dirty = false;
+
+				char* data = &m_uniformData[slot.Offset];
+				if (!m_packUniform(slot, data))
+					continue;
+
+				if (slot.InBlock) {
+					blockStart = std::min<size_t>(blockStart, slot.Offset);
+					blockEnd = std::max<size_t>(blockEnd, slot.Offset + slot.Size);
+					continue;
+				}
+
+				const GLint* ival = (const GLint*)data;
+				const GLuint* uval = (const GLuint*)data;
+				const GLfloat* fval = (const GLfloat*)data;
+				const auto& loc = slot.Location;
+				uploads++;
+				switch (slot.Type) {
+				case ShaderLanguage::TYPE_BOOL: glUniform1iv(loc, 1, ival); break;
+				case ShaderLanguage::TYPE_BVEC2: glUniform2iv(loc, 1, ival); break;
+				case ShaderLanguage::TYPE_BVEC3: glUniform3iv(loc, 1, ival); break;
+				case ShaderLanguage::TYPE_BVEC4: glUniform4iv(loc, 1, ival); break;
+				case ShaderLanguage::TYPE_INT: glUniform1iv(loc, 1, ival); break;
+				case ShaderLanguage::TYPE_IVEC2: glUniform2iv(loc, 1, ival); break;
+				case ShaderLanguage::TYPE_IVEC3: glUniform3iv(loc, 1, ival); break;
+				case ShaderLanguage::TYPE_IVEC4: glUniform4iv(loc, 1, ival); break;
+				case ShaderLanguage::TYPE_UINT: glUniform1uiv(loc, 1, uval); break;
+				case ShaderLanguage::TYPE_UVEC2: glUniform2uiv(loc, 1, uval); break;
+				case ShaderLanguage::TYPE_UVEC3: glUniform3uiv(loc, 1, uval); break;
+				case ShaderLanguage::TYPE_UVEC4: glUniform4uiv(loc, 1, uval); break;
+				case ShaderLanguage::TYPE_FLOAT: glUniform1fv(loc, 1, fval); break;
+				case ShaderLanguage::TYPE_VEC2: glUniform2fv(loc, 1, fval); break;
+				case ShaderLanguage::TYPE_VEC3: glUniform3fv(loc, 1, fval); break;
+				case ShaderLanguage::TYPE_VEC4: glUniform4fv(loc, 1, fval); break;
+				case ShaderLanguage::TYPE_MAT2: glUniformMatrix2fv(loc, 1, GL_FALSE, fval); break;
+				case ShaderLanguage::TYPE_MAT3: glUniformMatrix3fv(loc, 1, GL_FALSE, fval); break;
+				case ShaderLanguage::TYPE_MAT4: glUniformMatrix4fv(loc, 1, GL_FALSE, fval); break;
+				}
+			}
 
-			glUniform1i(glGetUniformLocation(m_shader, "color_texture"), 0);
-
-			for (const auto& uniform : m_uniforms) {
-				const auto& val = uniform.second.Value;
-				const auto& loc = uniform.second.Location;
-				switch (uniform.second.Type) {
-				case ShaderLanguage::TYPE_BOOL: glUniform1i(loc, val[0].sint); break;
-				case ShaderLanguage::TYPE_BVEC2: glUniform2i(loc, val[0].sint, val[1].sint); break;
-				case ShaderLanguage::TYPE_BVEC3: glUniform3i(loc, val[0].sint, val[1].sint, val[2].sint); break;
-				case ShaderLanguage::TYPE_BVEC4: glUniform4i(loc, val[0].sint, val[1].sint, val[2].sint, val[3].sint); break;
-				case ShaderLanguage::TYPE_INT: glUniform1i(loc, val[0].sint); break;
-				case ShaderLanguage::TYPE_IVEC2: glUniform2i(loc, val[0].sint, val[1].sint); break;
-				case ShaderLanguage::TYPE_IVEC3: glUniform3i(loc, val[0].sint, val[1].sint, val[2].sint); break;
-				case ShaderLanguage::TYPE_IVEC4: glUniform4i(loc, val[0].sint, val[1].sint, val[2].sint, val[3].sint); break;
-				case ShaderLanguage::TYPE_UINT: glUniform1ui(loc, val[0].uint); break;
-				case ShaderLanguage::TYPE_UVEC2: glUniform2ui(loc, val[0].uint, val[1].uint); break;
-				case ShaderLanguage::TYPE_UVEC3: glUniform3ui(loc, val[0].uint, val[1].uint, val[2].uint); break;
-				case ShaderLanguage::TYPE_UVEC4: glUniform4ui(loc, val[0].uint, val[1].uint, val[2].uint, val[3].uint); break;
-				case ShaderLanguage::TYPE_FLOAT: glUniform1f(loc, val[0].real); break;
-				case ShaderLanguage::TYPE_VEC2: glUniform2f(loc, val[0].real, val[1].real); break;
-				case ShaderLanguage::TYPE_VEC3: glUniform3f(loc, val[0].real, val[1].real, val[2].real); break;
-				case ShaderLanguage::TYPE_VEC4: glUniform4f(loc, val[0].real, val[1].real, val[2].real, val[3].real); break;
-				case ShaderLanguage::TYPE_MAT2: glUniformMatrix2fv(loc, 1, GL_FALSE, (float*)&val[0]); break;
-				case ShaderLanguage::TYPE_MAT3: glUniformMatrix3fv(loc, 1, GL_FALSE, (float*)&val[0]); break;
-				case ShaderLanguage::TYPE_MAT4: glUniformMatrix4fv(loc, 1, GL_FALSE, (float*)&val[0]); break;
-				case ShaderLanguage::TYPE_SAMPLER2D:
-					glActiveTexture(GL_TEXTURE0 + loc);
-					glBindTexture(GL_TEXTURE_2D, val[0].uint);
-					glUniform1i(glGetUniformLocation(m_shader, ("m_" + uniform.first).c_str()), loc);
-					break;
+			if (m_ubo != 0) {
+				if (blockStart < blockEnd) {
+					glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+					glBufferSubData(GL_UNIFORM_BUFFER, blockStart, blockEnd - blockStart, &m_uniformData[blockStart]);
+					glBindBuffer(GL_UNIFORM_BUFFER, 0);
+					uploads++;
 				}
+				glBindBufferBase(GL_UNIFORM_BUFFER, USER_UNIFORM_BLOCK_BINDING, m_ubo);
 			}
 
+			FrameStats::Instance().Add(FrameCounter::UniformUploads, uploads);
+
+			// texture units are shared between materials, GLState skips the ones that are already bound
+			GLState& state = GLState::Instance();
+			for (const auto& sampler : m_samplers)
+				state.BindTexture(sampler->Location, sampler->Value[0].uint);
+
 			if (m_glslData.BlendMode == Shader::CanvasItem::BLEND_MODE_DISABLED) {
-				glDisable(GL_BLEND);
+				state.Enable(GL_BLEND, false);
 			} else {
-				glEnable(GL_BLEND);
+				state.Enable(GL_BLEND, true);
 				switch (m_glslData.BlendMode) {
 					//-1 not handled because not blend is enabled anyway
 				case Shader::CanvasItem::BLEND_MODE_MIX: {
-					glBlendEquation(GL_FUNC_ADD);
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+					state.BlendEquation(GL_FUNC_ADD);
+					state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 				} break;
 				case Shader::CanvasItem::BLEND_MODE_ADD: {
-					glBlendEquation(GL_FUNC_ADD);
-					glBlendFunc(GL_ONE, GL_ONE);
+					state.BlendEquation(GL_FUNC_ADD);
+					state.BlendFunc(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
 				} break;
 				case Shader::CanvasItem::BLEND_MODE_SUB: {
-					glBlendEquation(GL_FUNC_REVERSE_SUBTRACT);
-					glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+					state.BlendEquation(GL_FUNC_REVERSE_SUBTRACT);
+					state.BlendFunc(GL_SRC_ALPHA, GL_ONE, GL_SRC_ALPHA, GL_ONE);
 				} break;
 				case Shader::CanvasItem::BLEND_MODE_MUL: {
-					glBlendEquation(GL_FUNC_ADD);
-					glBlendFuncSeparate(GL_DST_COLOR, GL_ZERO, GL_ZERO, GL_ONE);
+					state.BlendEquation(GL_FUNC_ADD);
+					state.BlendFunc(GL_DST_COLOR, GL_ZERO, GL_ZERO, GL_ONE);
 				} break;
 				}
 			}
@@ -185,6 +426,86 @@ namespace gd
 			}
 			ImGui::NextColumn();
 
+			/* sprite draw mode */
+			ImGui::Text("Draw mode:");
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Batched: sprites are transformed on the CPU, so VERTEX is in canvas space inside vertex()\nInstanced: all sprites are drawn with one instanced draw call per texture");
+			ImGui::NextColumn();
+			ImGui::PushItemWidth(-1);
+			int drawMode = (int)DrawMode;
+			if (ImGui::Combo("##pui_drawmode", &drawMode, "Individual\0Batched\0Instanced\0")) {
+				DrawMode = (SpriteDrawMode)drawMode;
+				Owner->ModifyProject(Owner->Project);
+				Compile(); // instanced mode needs a different vertex shader
+			}
+			ImGui::PopItemWidth();
+			ImGui::NextColumn();
+
+			/* texture atlas */
+			if (DrawMode != SpriteDrawMode::Individual) {
+				ImGui::Text("Texture atlas:");
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("Sprite textures are packed together so that sprites with different textures share a draw call.\nUV points to the sprite's region in the atlas.");
+				ImGui::NextColumn();
+				if (ImGui::Checkbox("##pui_atlas", &UseTextureAtlas))
+					Owner->ModifyProject(Owner->Project);
+				ImGui::NextColumn();
+			}
+
+			/* uniform buffer */
+			ImGui::Text("Uniform buffer:");
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Store uniforms in a std140 uniform block that is updated with one call");
+			ImGui::NextColumn();
+			if (ImGui::Checkbox("##pui_ubo", &UseUniformBuffer)) {
+				Owner->ModifyProject(Owner->Project);
+				Compile();
+			}
+			ImGui::NextColumn();
+
+			/* SCREEN_TEXTURE region */
+			ImGui::Text("Limit screen copy:");
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Only copy & blur the part of SCREEN_TEXTURE that is covered by the sprites.\nIncrease the margin if the shader reads SCREEN_TEXTURE outside of the sprite (distortion, refraction).");
+			ImGui::NextColumn();
+			if (ImGui::Checkbox("##pui_screenregion", &LimitScreenCopy))
+				Owner->ModifyProject(Owner->Project);
+			ImGui::NextColumn();
+
+			if (LimitScreenCopy) {
+				ImGui::Text("Screen copy margin:");
+				ImGui::NextColumn();
+				ImGui::PushItemWidth(-1);
+				if (ImGui::DragInt("##pui_screenmargin", &ScreenCopyMargin, 1.0f, 0, 4096))
+					Owner->ModifyProject(Owner->Project);
+				ImGui::PopItemWidth();
+				ImGui::NextColumn();
+			}
+
+			/* SCREEN_TEXTURE snapshot */
+			ImGui::Text("Screen snapshot:");
+			if (ImGui::IsItemHovered())
+				ImGui::SetTooltip("Named BackBufferCopy snapshot that SCREEN_TEXTURE reads.\nDefault reads the screen as it is when this material is drawn.");
+			ImGui::NextColumn();
+			ImGui::PushItemWidth(-1);
+			if (ImGui::BeginCombo("##pui_screensnapshot", ScreenSnapshot[0] == 0 ? "Default" : ScreenSnapshot)) {
+				if (ImGui::Selectable("Default", ScreenSnapshot[0] == 0)) {
+					ScreenSnapshot[0] = 0;
+					Owner->ModifyProject(Owner->Project);
+				}
+
+				std::vector<std::string> names = ((gd::GodotShaders*)Owner)->GetSnapshotNames();
+				for (const auto& name : names)
+					if (ImGui::Selectable(name.c_str(), name == ScreenSnapshot)) {
+						strcpy(ScreenSnapshot, name.c_str());
+						Owner->ModifyProject(Owner->Project);
+					}
+
+				ImGui::EndCombo();
+			}
+			ImGui::PopItemWidth();
+			ImGui::NextColumn();
+
 
 			ImGui::Columns(1);
 		}
@@ -216,6 +537,193 @@ namespace gd
 			ImGui::Columns(1);
 		}
 
+		void CanvasMaterial::m_buildUniformLayout()
+		{
+			m_uniformLayout.clear();
+			m_samplers.clear();
+
+			// get the std140 layout from the driver
+			GLuint blockIndex = GL_INVALID_INDEX;
+			GLint blockSize = 0;
+			if (UseUniformBuffer) {
+				blockIndex = glGetUniformBlockIndex(m_shader, USER_UNIFORM_BLOCK_NAME);
+				if (blockIndex != GL_INVALID_INDEX) {
+					glUniformBlockBinding(m_shader, blockIndex, USER_UNIFORM_BLOCK_BINDING);
+					glGetActiveUniformBlockiv(m_shader, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &blockSize);
+				}
+			}
+
+			// uniforms that are not in the block are stored after it
+			unsigned int offset = blockSize;
+			for (auto& uniform : m_uniforms) {
+				Uniform* u = &uniform.second;
+				u->Dirty = true; // new program -> everything has to be uploaded again
+
+				if (u->Type == ShaderLanguage::TYPE_SAMPLER2D)
+					m_samplers.push_back(u);
+				else if (!ShaderLanguage::is_sampler_type(u->Type) && u->Type != ShaderLanguage::TYPE_VOID) {
+					UniformSlot slot;
+					slot.Location = u->Location;
+					slot.Type = u->Type;
+					slot.Components = ShaderLanguage::get_cardinality(u->Type);
+					slot.Columns = 1;
+					if (u->Type == ShaderLanguage::TYPE_MAT2) slot.Columns = 2;
+					else if (u->Type == ShaderLanguage::TYPE_MAT3) slot.Columns = 3;
+					else if (u->Type == ShaderLanguage::TYPE_MAT4) slot.Columns = 4;
+					slot.MatrixStride = slot.Columns == 1 ? 0 : (slot.Components / slot.Columns) * sizeof(GLfloat);
+					slot.InBlock = false;
+					slot.Source = u;
+
+					if (blockIndex != GL_INVALID_INDEX) {
+						std::string name = "m_" + uniform.first;
+						const char* namePtr = name.c_str();
+						GLuint index = GL_INVALID_INDEX;
+						glGetUniformIndices(m_shader, 1, &namePtr, &index);
+
+						if (index != GL_INVALID_INDEX) {
+							GLint blockOffset = 0, matrixStride = 0;
+							glGetActiveUniformsiv(m_shader, 1, &index, GL_UNIFORM_OFFSET, &blockOffset);
+							glGetActiveUniformsiv(m_shader, 1, &index, GL_UNIFORM_MATRIX_STRIDE, &matrixStride);
+
+							slot.InBlock = true;
+							slot.Offset = blockOffset;
+							if (slot.Columns > 1)
+								slot.MatrixStride = matrixStride;
+						}
+					}
+
+					slot.Size = (slot.Columns - 1) * slot.MatrixStride + (slot.Components / slot.Columns) * sizeof(GLfloat);
+					if (!slot.InBlock) {
+						slot.Offset = offset;
+						offset += slot.Size;
+					}
+
+					m_uniformLayout.push_back(slot);
+				}
+			}
+
+			m_uniformData.resize(offset);
+
+			// create the uniform buffer
+			if (blockSize > 0) {
+				if (m_ubo == 0)
+					glGenBuffers(1, &m_ubo);
+				glBindBuffer(GL_UNIFORM_BUFFER, m_ubo);
+				glBufferData(GL_UNIFORM_BUFFER, blockSize, nullptr, GL_DYNAMIC_DRAW);
+				glBindBuffer(GL_UNIFORM_BUFFER, 0);
+			} else if (m_ubo != 0) {
+				glDeleteBuffers(1, &m_ubo);
+				m_ubo = 0;
+			}
+		}
+		bool CanvasMaterial::m_getScreenRegion(glm::ivec4& region)
+		{
+			if (!GetBounds(region))
+				return false;
+
+			// no sprites -> nothing to copy
+			if (region.x >= region.z || region.y >= region.w)
+				return true;
+
+			region.x -= ScreenCopyMargin;
+			region.y -= ScreenCopyMargin;
+			region.z += ScreenCopyMargin;
+			region.w += ScreenCopyMargin;
+
+			return true;
+		}
+		bool CanvasMaterial::GetBounds(glm::ivec4& region)
+		{
+			// vertex positions don't come from the sprite's matrix
+			if (m_glslData.SkipVertexTransform)
+				return false;
+
+			glm::vec2 minPos(FLT_MAX), maxPos(-FLT_MAX);
+			bool hasSprites = false;
+			for (PipelineItem* item : Items) {
+				if (item->Type != PipelineItemType::Sprite)
+					continue;
+
+				Sprite* sprite = (Sprite*)item;
+				if (!sprite->IsVisible())
+					continue;
+
+				glm::mat4 matrix = sprite->GetMatrix();
+				const CanvasVertex* verts = sprite->GetVertices();
+				for (int i = 0; i < 6; i++) {
+					glm::vec4 pos = matrix * glm::vec4(verts[i].Position, 0.0f, 1.0f);
+					minPos = glm::min(minPos, glm::vec2(pos.x, pos.y));
+					maxPos = glm::max(maxPos, glm::vec2(pos.x, pos.y));
+				}
+				hasSprites = true;
+			}
+
+			if (!hasSprites) {
+				region = glm::ivec4(0);
+				return true;
+			}
+
+			// canvas -> framebuffer coordinates (y goes up)
+			region.x = (int)std::floor(minPos.x);
+			region.y = (int)std::floor(m_vh - maxPos.y);
+			region.z = (int)std::ceil(maxPos.x);
+			region.w = (int)std::ceil(m_vh - minPos.y);
+
+			return true;
+		}
+		bool CanvasMaterial::HasSameState(CanvasMaterial* other)
+		{
+			if (m_shader == 0 || m_shader != other->m_shader || m_uniformLayout.size() != other->m_uniformLayout.size() || m_samplers.size() != other->m_samplers.size())
+				return false;
+
+			for (size_t i = 0; i < m_samplers.size(); i++)
+				if (m_samplers[i]->Location != other->m_samplers[i]->Location || m_samplers[i]->Value[0].uint != other->m_samplers[i]->Value[0].uint)
+					return false;
+
+			// m_uniformData is only updated in Bind() -> pack the current values, on the stack since this runs for every sprite
+			char mine[MAX_UNIFORM_SLOT_SIZE], theirs[MAX_UNIFORM_SLOT_SIZE];
+			for (size_t i = 0; i < m_uniformLayout.size(); i++) {
+				const UniformSlot& slot = m_uniformLayout[i];
+				const UniformSlot& otherSlot = other->m_uniformLayout[i];
+				if (slot.Location != otherSlot.Location || slot.Type != otherSlot.Type || slot.Size != otherSlot.Size || slot.InBlock != otherSlot.InBlock)
+					return false;
+				if (slot.Size > MAX_UNIFORM_SLOT_SIZE) // driver with an unusual matrix stride -> just don't batch
+					return false;
+
+				memset(mine, 0, slot.Size);
+				memset(theirs, 0, slot.Size);
+				if (m_packUniform(slot, mine) != other->m_packUniform(otherSlot, theirs))
+					return false;
+				if (memcmp(mine, theirs, slot.Size) != 0)
+					return false;
+			}
+
+			return true;
+		}
+		bool CanvasMaterial::m_packUniform(const UniformSlot& slot, char* out)
+		{
+			const auto& val = slot.Source->Value;
+			if (val.size() < slot.Components)
+				return false;
+
+			// bools only occupy one byte of the union -> convert them to proper ints
+			bool isBool = ShaderLanguage::get_scalar_type(slot.Type) == ShaderLanguage::TYPE_BOOL;
+			int rows = slot.Components / slot.Columns;
+
+			for (int c = 0; c < slot.Columns; c++) {
+				ShaderLanguage::ConstantNode::Value* dst = (ShaderLanguage::ConstantNode::Value*)(out + c * slot.MatrixStride);
+				for (int r = 0; r < rows; r++) {
+					const auto& src = val[c * rows + r];
+					if (isBool)
+						dst[r].sint = src.boolean ? 1 : 0;
+					else
+						dst[r] = src;
+				}
+			}
+
+			return true;
+		}
+
 		void CanvasMaterial::SetModelMatrix(glm::mat4 mat)
 		{
 			m_modelMat = mat;
@@ -224,99 +732,337 @@ namespace gd
 				glUniformMatrix4fv(m_modelMatrixLoc, 1, GL_FALSE, glm::value_ptr(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -1000.0f))));
 			else
 				glUniformMatrix4fv(m_modelMatrixLoc, 1, GL_FALSE, glm::value_ptr(m_modelMat));
+			FrameStats::Instance().Add(FrameCounter::UniformUploads);
 		}
-		void CanvasMaterial::Compile()
+		std::string CanvasMaterial::GetShaderFilePath()
 		{
-			std::string vsCodeContent = ResourceManager::Instance().GetDefaultCanvasVertexShader();
-			std::string psCodeContent = ResourceManager::Instance().GetDefaultCanvasPixelShader();
+			if (strlen(ShaderPath) == 0)
+				return "";
 
-			std::string godotShaderContents = "";
+			char outPath[MAX_PATH_LENGTH];
+			Owner->GetProjectPath(Owner->Project, ShaderPath, outPath);
 
-			if (strlen(ShaderPath) != 0) {
-				char outPath[MAX_PATH_LENGTH];
-				Owner->GetProjectPath(Owner->Project, ShaderPath, outPath);
-
-				godotShaderContents = LoadFile(outPath);
-			}
+			return outPath;
+		}
+		std::string CanvasMaterial::LoadShaderFile(const std::string& path)
+		{
+			if (path.empty())
+				return "";
+			return LoadFile(path);
+		}
+		void CanvasMaterial::Compile()
+		{
+			std::string godotShaderContents = LoadShaderFile(GetShaderFilePath());
 
 			const char* filedata = godotShaderContents.c_str();
 			int filesize = godotShaderContents.size();
 
 			CompileFromSource(filedata, filesize);
 		}
-		void CanvasMaterial::CompileFromSource(const char* filedata, int filesize)
+		void CanvasMaterial::CompileFromSource(const char* filedata, int filesize, bool incremental)
 		{
+			// this source replaces whatever the editor queued before
+			m_hasQueuedSource = false;
+			m_queuedSource.clear();
+
+			bool hasSource = filesize != 0 && filedata != nullptr;
+			unsigned int variant = (DrawMode == SpriteDrawMode::Instanced) | (UseUniformBuffer << 1);
+			uint64_t tokenKey = hasSource ? ShaderCache::GetTokenKey(std::string(filedata, filesize), variant) : 0;
+
 			Owner->ClearMessageGroup(Owner->Messages, Name);
 
-			std::string vsCodeContent = ResourceManager::Instance().GetDefaultCanvasVertexShader();
-			std::string psCodeContent = ResourceManager::Instance().GetDefaultCanvasPixelShader();
+			// the edit only changed comments or whitespace -> the current program is still up to date,
+			// its messages are emitted again so that nothing keeps pointing at lines that have moved
+			if (incremental && tokenKey != 0 && m_pending == nullptr && m_program != nullptr && tokenKey == m_programTokenKey) {
+				m_addProgramMessages();
+				return;
+			}
 
-			auto unif = m_glslData.Uniforms;
+			// newer source replaces the one that is still being compiled
+			m_cancelCompile();
 
-			if (filesize != 0 && filedata != nullptr) {
-				gd::ShaderTranscompiler::Transcompile(filedata, m_glslData);
+			std::shared_ptr<PendingCompile> pending = std::make_shared<PendingCompile>();
+			const char* projectDir = Owner->GetProjectDirectory(Owner->Project);
+			pending->HasSource = hasSource;
+			pending->Source = pending->HasSource ? std::string(filedata, filesize) : "";
+			pending->ProjectDir = projectDir ? projectDir : "";
+			pending->Instanced = DrawMode == SpriteDrawMode::Instanced;
+			pending->UniformBuffer = UseUniformBuffer;
+			pending->Variant = variant;
+			pending->TokenKey = tokenKey;
+			pending->Data.Output = m_glslData;
+			pending->Data.Program = 0;
+			pending->Program = nullptr;
+			pending->IsLinking = false;
+			pending->VS = pending->PS = 0;
 
-				if (!m_glslData.Error) {
-					vsCodeContent = m_glslData.Vertex;
-					psCodeContent = m_glslData.Fragment;
-				} else {
-					Owner->AddMessage(Owner->Messages, ed::plugin::MessageType::Error, Name, m_glslData.ErrorMessage.c_str(), m_glslData.ErrorLine);
+			// skip the transcompiler & the driver's compiler if this exact shader was built before
+			bool isCached = false;
+			if (pending->HasSource) {
+				pending->Program = ShaderCache::Instance().Acquire(pending->Source, pending->Variant);
+				if (pending->Program != nullptr) {
+					pending->Data = pending->Program->Data;
+					isCached = true;
+				} else
+					isCached = ShaderCache::Instance().Load(pending->ProjectDir, pending->Source, pending->Variant, pending->Data);
+			}
+
+			m_pending = pending;
+			m_programTokenKey = 0; // until the new program replaces it
+
+			if (!isCached) {
+				// parsing the Godot shader is pure CPU work -> the current program is used until it's done
+				if (pending->HasSource) {
+					m_pendingJob = CompileQueue::Instance().Submit([pending]() {
+						CanvasMaterial::m_transcompile(*pending);
+					});
 					return;
 				}
+
+				m_transcompile(*pending);
 			}
 
-			const char* vsCode = vsCodeContent.c_str();
-			const char* psCode = psCodeContent.c_str();
+			Update();
+		}
+		void CanvasMaterial::QueueCompileFromSource(const char* filedata, int filesize, bool incremental)
+		{
+			// typing sends a new source every few keystrokes -> restart the timer, Update() compiles the last one
+			m_queuedSource.assign(filedata != nullptr ? filedata : "", filedata != nullptr ? filesize : 0);
+			m_queuedIncremental = incremental;
+			m_queuedTime = std::chrono::steady_clock::now();
+			m_hasQueuedSource = true;
+		}
+		void CanvasMaterial::m_compileQueuedSource()
+		{
+			std::string source = std::move(m_queuedSource);
+			CompileFromSource(source.c_str(), source.size(), m_queuedIncremental);
+		}
+		void CanvasMaterial::WaitForCompile()
+		{
+			if (m_hasQueuedSource)
+				m_compileQueuedSource();
+
+			if (m_pendingJob != nullptr)
+				CompileQueue::Instance().Wait(m_pendingJob);
+
+			while (m_pending != nullptr)
+				Update();
+		}
+		void CanvasMaterial::Update()
+		{
+			if (m_hasQueuedSource && std::chrono::steady_clock::now() - m_queuedTime >= std::chrono::milliseconds(COMPILE_QUEUE_DELAY))
+				m_compileQueuedSource();
+
+			if (m_pending == nullptr)
+				return;
+
+			// transcompiler
+			if (m_pendingJob != nullptr) {
+				if (!m_pendingJob->IsFinished())
+					return;
+				m_pendingJob = nullptr;
+
+				const GLSLOutput& output = m_pending->Data.Output;
+				if (output.Error) {
+					Owner->AddMessage(Owner->Messages, ed::plugin::MessageType::Error, Name, output.ErrorMessage.c_str(), output.ErrorLine);
+					m_pending = nullptr;
+					return;
+				}
+			}
+
+			// compile & link on the GL thread
+			if (m_pending->Program == nullptr && (m_pending->Data.Program == 0 || m_pending->IsLinking))
+				if (!m_link())
+					return;
+
+			m_applyCompile();
+		}
+
+		void CanvasMaterial::m_transcompile(PendingCompile& data)
+		{
+			// runs on a worker thread when there is a Godot shader
+			std::string vsCodeContent, psCodeContent;
+
+			if (data.HasSource) {
+				{
+					std::lock_guard<std::mutex> lock(transcompileMutex);
+					gd::ShaderTranscompiler::Transcompile(data.Source, data.Data.Output);
+				}
+
+				if (data.Data.Output.Error)
+					return;
+
+				vsCodeContent = data.Data.Output.Vertex;
+				psCodeContent = data.Data.Output.Fragment;
+			} else {
+				vsCodeContent = ResourceManager::Instance().GetDefaultCanvasVertexShader();
+				psCodeContent = ResourceManager::Instance().GetDefaultCanvasPixelShader();
+			}
+
+			// user uniforms -> std140 uniform block
+			if (data.UniformBuffer && data.HasSource)
+				moveUniformsToBlock(data.Data.Output, vsCodeContent, psCodeContent);
+
+			// SCREEN_UV -> pooled SCREEN_TEXTURE coordinates
+			if (data.HasSource && data.Data.Output.SCREEN_TEXTURE) {
+				remapScreenTexture(vsCodeContent, false);
+				remapScreenTexture(psCodeContent, true);
+			}
+
+			// instanced variant of the vertex shader
+			data.Data.Instanced = false;
+			if (data.Instanced) {
+				std::string instancedVS = !data.HasSource ? ResourceManager::Instance().GetDefaultCanvasInstancedVertexShader() :
+					SpriteInstancer::CreateInstancedVertexShader(vsCodeContent);
+				if (!instancedVS.empty()) {
+					vsCodeContent = std::move(instancedVS);
+					data.Data.Instanced = true;
+				}
+			}
+
+			data.Data.Vertex = std::move(vsCodeContent);
+			data.Data.Fragment = std::move(psCodeContent);
+		}
+		bool CanvasMaterial::m_link()
+		{
+			PendingCompile& data = *m_pending;
+
+			if (!data.IsLinking) {
+				const char* vsCode = data.Data.Vertex.c_str();
+				const char* psCode = data.Data.Fragment.c_str();
+
+				// create vertex shader
+				data.VS = glCreateShader(GL_VERTEX_SHADER);
+				glShaderSource(data.VS, 1, &vsCode, nullptr);
+				glCompileShader(data.VS);
+
+				// create pixel shader
+				data.PS = glCreateShader(GL_FRAGMENT_SHADER);
+				glShaderSource(data.PS, 1, &psCode, nullptr);
+				glCompileShader(data.PS);
+
+				// create a shader program for gizmo
+				data.Data.Program = glCreateProgram();
+				if (data.HasSource)
+					glProgramParameteri(data.Data.Program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+				glAttachShader(data.Data.Program, data.VS);
+				glAttachShader(data.Data.Program, data.PS);
+				glLinkProgram(data.Data.Program);
+
+				data.IsLinking = true;
+			}
+
+			// don't block the GL thread while the driver compiles in the background
+			if (GLEW_KHR_parallel_shader_compile) {
+				GLint isCompleted = 0;
+				glGetProgramiv(data.Data.Program, GL_COMPLETION_STATUS_KHR, &isCompleted);
+				if (!isCompleted)
+					return false;
+			}
 
 			GLint success = 0;
 			char infoLog[512];
 
-			if (m_shader != 0)
-				glDeleteShader(m_shader);
-
-			// create vertex shader
-			unsigned int canvasVS = glCreateShader(GL_VERTEX_SHADER);
-			glShaderSource(canvasVS, 1, &vsCode, nullptr);
-			glCompileShader(canvasVS);
-			glGetShaderiv(canvasVS, GL_COMPILE_STATUS, &success);
+			glGetShaderiv(data.VS, GL_COMPILE_STATUS, &success);
 			if (!success) {
-				glGetShaderInfoLog(canvasVS, 512, NULL, infoLog);
+				glGetShaderInfoLog(data.VS, 512, NULL, infoLog);
 				Owner->Log("Failed to compile a GCanvasMaterial vertex shader", true, nullptr, -1);
 				Owner->Log(infoLog, true, nullptr, -1);
 			}
 
-			// create pixel shader
-			unsigned int canvasPS = glCreateShader(GL_FRAGMENT_SHADER);
-			glShaderSource(canvasPS, 1, &psCode, nullptr);
-			glCompileShader(canvasPS);
-			glGetShaderiv(canvasPS, GL_COMPILE_STATUS, &success);
+			glGetShaderiv(data.PS, GL_COMPILE_STATUS, &success);
 			if (!success) {
-				glGetShaderInfoLog(canvasPS, 512, NULL, infoLog);
+				glGetShaderInfoLog(data.PS, 512, NULL, infoLog);
 				Owner->Log("Failed to compile a GCanvasMaterial pixel shader", true, nullptr, -1);
 				Owner->Log(infoLog, true, nullptr, -1);
 			}
 
-			// create a shader program for gizmo
-			m_shader = glCreateProgram();
-			glAttachShader(m_shader, canvasVS);
-			glAttachShader(m_shader, canvasPS);
-			glLinkProgram(m_shader);
-			glGetProgramiv(m_shader, GL_LINK_STATUS, &success);
+			glGetProgramiv(data.Data.Program, GL_LINK_STATUS, &success);
 			if (!success) {
-				glGetProgramInfoLog(m_shader, 512, NULL, infoLog);
+				glGetProgramInfoLog(data.Data.Program, 512, NULL, infoLog);
 				Owner->Log("Failed to create a GCanvasMaterial shader program", true, nullptr, -1);
 				Owner->Log(infoLog, true, nullptr, -1);
+
+				// the next edit has to be compiled even if it only changes comments or whitespace
+				data.TokenKey = 0;
+			}
+			else if (data.HasSource)
+				ShaderCache::Instance().Save(data.ProjectDir, data.Source, data.Variant, data.Data);
+
+			glDeleteShader(data.VS);
+			glDeleteShader(data.PS);
+			data.VS = data.PS = 0;
+			data.IsLinking = false;
+
+			// only working programs compiled from a Godot shader are shared
+			data.Program = ShaderCache::Instance().Create(data.Source, data.Variant, data.Data, data.HasSource && success);
+
+			return true;
+		}
+		void CanvasMaterial::m_cancelCompile()
+		{
+			if (m_pendingJob != nullptr) {
+				m_pendingJob->Cancel(); // the worker still owns its copy of m_pending
+				m_pendingJob = nullptr;
+			}
+
+			if (m_pending != nullptr) {
+				if (m_pending->Program != nullptr)
+					ShaderCache::Instance().Release(m_pending->Program);
+				else if (m_pending->Data.Program != 0)
+					glDeleteProgram(m_pending->Data.Program);
+				if (m_pending->VS != 0)
+					glDeleteShader(m_pending->VS);
+				if (m_pending->PS != 0)
+					glDeleteShader(m_pending->PS);
+				m_pending = nullptr;
 			}
+		}
+		void CanvasMaterial::m_applyCompile()
+		{
+			std::shared_ptr<PendingCompile> pending = m_pending;
+			m_pending = nullptr;
+
+			if (pending->Program == nullptr)
+				pending->Program = ShaderCache::Instance().Create(pending->Source, pending->Variant, pending->Data, pending->HasSource);
+
+			auto unif = m_glslData.Uniforms;
+
+			if (m_program != nullptr)
+				ShaderCache::Instance().Release(m_program);
+			m_program = pending->Program;
+			m_programTokenKey = pending->TokenKey;
+			m_shader = m_program->Data.Program;
+			m_glslData = pending->Data.Output;
+			m_instanced = pending->Data.Instanced;
+			m_addProgramMessages();
+
+			// only generate the SCREEN_TEXTURE levels that are sampled
+			m_screenLevels = 0;
+			if (m_glslData.SCREEN_TEXTURE) {
+				int vsLevels = getScreenTextureLevels(pending->Data.Vertex);
+				int psLevels = getScreenTextureLevels(pending->Data.Fragment);
+				m_screenLevels = (vsLevels < 0 || psLevels < 0) ? -1 : std::max<int>(vsLevels, psLevels);
+			}
+
+			// reads that remapScreenTexture() couldn't scale need a SCREEN_TEXTURE with the viewport's size
+			m_screenExact = m_glslData.SCREEN_TEXTURE &&
+				(hasUnscaledScreenTextureReads(pending->Data.Vertex) || hasUnscaledScreenTextureReads(pending->Data.Fragment));
 
-			//glDeleteShader(canvasPS);
-			//glDeleteShader(canvasVS);
+			// sampler -> texture unit assignments never change so they are stored in the program once
+			GLint lastProgram = 0;
+			glGetIntegerv(GL_CURRENT_PROGRAM, &lastProgram);
+			glUseProgram(m_shader);
 
 			m_projMatrixLoc = glGetUniformLocation(m_shader, "projection_matrix");
 			m_modelMatrixLoc = glGetUniformLocation(m_shader, "modelview_matrix");
 			m_timeLoc = glGetUniformLocation(m_shader, "time");
 			m_pixelSizeLoc = glGetUniformLocation(m_shader, "screen_pixel_size");
+			m_screenUVScaleLoc = glGetUniformLocation(m_shader, "gd_screen_uv_scale");
+			m_screenUVMaxLoc = glGetUniformLocation(m_shader, "gd_screen_uv_max");
 
 			glUniform1i(glGetUniformLocation(m_shader, "color_texture"), 0); // color_texture -> texunit: 0
+			glUniform1i(glGetUniformLocation(m_shader, "screen_texture"), 1); // screen_texture -> texunit: 1
 			
 
 			// user uniforms
@@ -389,6 +1135,16 @@ namespace gd
 
 			for (const auto& uniform : toBeErased)
 				m_uniforms.erase(uniform);
+
+			m_buildUniformLayout();
+
+			glUseProgram(lastProgram);
+		}
+		void CanvasMaterial::m_addProgramMessages()
+		{
+			// variant bit 0 -> the instanced vertex shader was requested
+			if (m_program != nullptr && (m_program->Variant & 1) && !m_instanced)
+				Owner->AddMessage(Owner->Messages, ed::plugin::MessageType::Warning, Name, "Failed to create the instanced vertex shader - drawing sprites one by one", -1);
 		}
 	}
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include <Core/CompileQueue.h>
+
+namespace gd
+{
+	CompileQueue::CompileQueue()
+	{
+		m_exit = false;
+	}
+	CompileQueue::~CompileQueue()
+	{
+		Shutdown();
+	}
+
+	std::shared_ptr<CompileQueue::Job> CompileQueue::Submit(const std::function<void()>& func)
+	{
+		std::shared_ptr<Job> job = std::make_shared<Job>(func);
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (m_workers.size() == 0)
+				m_start();
+			m_jobs.push_back(job);
+		}
+		m_jobAdded.notify_one();
+
+		return job;
+	}
+	void CompileQueue::Wait(const std::shared_ptr<Job>& job)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!job->m_finished) {
+			if (!m_runNext(lock))
+				m_jobFinished.wait(lock);
+		}
+	}
+	void CompileQueue::Shutdown()
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_jobAdded.notify_all();
+
+		for (auto& worker : m_workers)
+			worker.join();
+		m_workers.clear();
+
+		// nobody will run the remaining jobs
+		for (auto& job : m_jobs)
+			job->m_finished = true;
+		m_jobs.clear();
+		m_exit = false;
+	}
+
+	void CompileQueue::m_start()
+	{
+		// leave one core for the GL thread
+		int count = std::thread::hardware_concurrency();
+		count = count > 2 ? count - 1 : 1;
+
+		for (int i = 0; i < count; i++)
+			m_workers.push_back(std::thread(&CompileQueue::m_work, this));
+	}
+	void CompileQueue::m_work()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_exit) {
+			if (!m_runNext(lock))
+				m_jobAdded.wait(lock);
+		}
+	}
+	bool CompileQueue::m_runNext(std::unique_lock<std::mutex>& lock)
+	{
+		// expects m_mutex to be locked
+		if (m_jobs.size() == 0)
+			return false;
+
+		std::shared_ptr<Job> job = m_jobs.front();
+		m_jobs.pop_front();
+
+		lock.unlock();
+		if (!job->m_cancelled)
+			job->m_func();
+		lock.lock();
+
+		job->m_finished = true;
+		m_jobFinished.notify_all();
+
+		return true;
+	}
+}
\ No newline at end of file
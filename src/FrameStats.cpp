@@ -0,0 +1,50 @@
+#include <Core/FrameStats.h>
+
+#include <imgui/imgui.h>
+
+namespace gd
+{
+	FrameStats::FrameStats()
+	{
+		ShowOverlay = false;
+		m_frame = 0;
+		for (int i = 0; i < (int)FrameCounter::Count; i++)
+			m_current[i] = m_last[i] = 0;
+	}
+
+	void FrameStats::BeginFrame()
+	{
+		for (int i = 0; i < (int)FrameCounter::Count; i++) {
+			m_last[i] = m_current[i];
+			m_current[i] = 0;
+		}
+		m_frame++;
+	}
+	const char* FrameStats::GetName(FrameCounter counter)
+	{
+		switch (counter) {
+		case FrameCounter::PipelineItems: return "pipeline_items";
+		case FrameCounter::DrawCalls: return "draw_calls";
+		case FrameCounter::ProgramBinds: return "program_binds";
+		case FrameCounter::TextureBinds: return "texture_binds";
+		case FrameCounter::FramebufferBinds: return "framebuffer_binds";
+		case FrameCounter::UniformUploads: return "uniform_uploads";
+		case FrameCounter::ScreenCopies: return "screen_copies";
+		case FrameCounter::BlurPasses: return "blur_passes";
+		default: return "";
+		}
+	}
+
+	void FrameStats::ShowOverlayWindow()
+	{
+		ImGui::SetNextWindowBgAlpha(0.6f);
+		ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav;
+		if (ImGui::Begin("##gd_frame_stats", &ShowOverlay, flags)) {
+			ImGui::Text("GodotShaders frame %llu", m_frame);
+			ImGui::Separator();
+			for (int i = 0; i < (int)FrameCounter::Count; i++)
+				ImGui::Text("%-18s %d", GetName((FrameCounter)i), m_last[i]);
+		}
+		ImGui::End();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include <Core/GLState.h>
+
+#include <GL/glew.h>
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+namespace gd
+{
+	GLState::GLState()
+	{
+		m_active = false;
+		m_issued = m_skipped = 0;
+		m_lastIssued = m_lastSkipped = 0;
+		Invalidate();
+	}
+
+	void GLState::Begin()
+	{
+		m_issued = m_skipped = 0;
+		Invalidate();
+		m_active = true;
+	}
+	void GLState::End()
+	{
+		m_active = false;
+		m_lastIssued = m_issued;
+		m_lastSkipped = m_skipped;
+	}
+	void GLState::Invalidate()
+	{
+		m_program = m_vao = m_drawFBO = m_readFBO = -1;
+		for (int i = 0; i < GL_STATE_TEXTURE_UNITS; i++)
+			m_textures[i] = -1;
+		m_activeUnit = -1;
+		for (int i = 0; i < 4; i++) {
+			m_viewport[i] = -1;
+			m_blendFunc[i] = -1;
+		}
+		m_blend = m_depthTest = m_cullFace = m_scissorTest = -1;
+		m_blendEquation = -1;
+	}
+
+	bool GLState::m_check(bool same, FrameCounter counter)
+	{
+		if (!m_active)
+			return true;
+
+		if (same) {
+			m_skipped++;
+			return false;
+		}
+
+		m_issued++;
+		if (counter != FrameCounter::Count)
+			FrameStats::Instance().Add(counter);
+		return true;
+	}
+	int* GLState::m_getCap(unsigned int cap)
+	{
+		switch (cap) {
+		case GL_BLEND: return &m_blend;
+		case GL_DEPTH_TEST: return &m_depthTest;
+		case GL_CULL_FACE: return &m_cullFace;
+		case GL_SCISSOR_TEST: return &m_scissorTest;
+		}
+		return nullptr;
+	}
+
+	void GLState::UseProgram(unsigned int prog)
+	{
+		if (m_check(m_program == prog, FrameCounter::ProgramBinds)) {
+			glUseProgram(prog);
+			m_program = prog;
+		}
+	}
+	void GLState::BindVertexArray(unsigned int vao)
+	{
+		if (m_check(m_vao == vao)) {
+			glBindVertexArray(vao);
+			m_vao = vao;
+		}
+	}
+	void GLState::BindTexture(int unit, unsigned int tex)
+	{
+		if (unit < 0 || unit >= GL_STATE_TEXTURE_UNITS) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(GL_TEXTURE_2D, tex);
+			m_activeUnit = -1;
+			return;
+		}
+
+		if (m_check(m_textures[unit] == tex, FrameCounter::TextureBinds)) {
+			if (m_check(m_activeUnit == unit)) {
+				glActiveTexture(GL_TEXTURE0 + unit);
+				m_activeUnit = unit;
+			}
+			glBindTexture(GL_TEXTURE_2D, tex);
+			m_textures[unit] = tex;
+		}
+	}
+	void GLState::ActiveTexture(int unit)
+	{
+		if (unit < 0 || unit >= GL_STATE_TEXTURE_UNITS) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			m_activeUnit = -1;
+			return;
+		}
+
+		if (m_check(m_activeUnit == unit)) {
+			glActiveTexture(GL_TEXTURE0 + unit);
+			m_activeUnit = unit;
+		}
+	}
+	void GLState::SelectTexture(int unit, unsigned int tex)
+	{
+		// BindTexture() doesn't touch the active unit if tex is already bound
+		BindTexture(unit, tex);
+		ActiveTexture(unit);
+	}
+	void GLState::BindFramebuffer(unsigned int target, unsigned int fbo)
+	{
+		bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+		bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+		bool same = (!draw || m_drawFBO == fbo) && (!read || m_readFBO == fbo);
+
+		if (m_check(same, FrameCounter::FramebufferBinds)) {
+			glBindFramebuffer(target, fbo);
+			if (draw) m_drawFBO = fbo;
+			if (read) m_readFBO = fbo;
+		}
+	}
+	void GLState::Viewport(int x, int y, int w, int h)
+	{
+		bool same = m_viewport[0] == x && m_viewport[1] == y && m_viewport[2] == w && m_viewport[3] == h;
+		if (m_check(same)) {
+			glViewport(x, y, w, h);
+			m_viewport[0] = x;
+			m_viewport[1] = y;
+			m_viewport[2] = w;
+			m_viewport[3] = h;
+		}
+	}
+	void GLState::Enable(unsigned int cap, bool enable)
+	{
+		int* cached = m_getCap(cap);
+		if (cached == nullptr) {
+			if (enable) glEnable(cap);
+			else glDisable(cap);
+			return;
+		}
+
+		if (m_check(*cached == (int)enable)) {
+			if (enable) glEnable(cap);
+			else glDisable(cap);
+			*cached = enable;
+		}
+	}
+	bool GLState::IsEnabled(unsigned int cap)
+	{
+		int* cached = m_getCap(cap);
+		if (!m_active || cached == nullptr)
+			return glIsEnabled(cap);
+
+		if (*cached == -1)
+			*cached = glIsEnabled(cap);
+		return *cached;
+	}
+	void GLState::BlendEquation(unsigned int mode)
+	{
+		if (m_check(m_blendEquation == mode)) {
+			glBlendEquation(mode);
+			m_blendEquation = mode;
+		}
+	}
+	void GLState::BlendFunc(unsigned int srcRGB, unsigned int dstRGB, unsigned int srcA, unsigned int dstA)
+	{
+		bool same = m_blendFunc[0] == srcRGB && m_blendFunc[1] == dstRGB && m_blendFunc[2] == srcA && m_blendFunc[3] == dstA;
+		if (m_check(same)) {
+			glBlendFuncSeparate(srcRGB, dstRGB, srcA, dstA);
+			m_blendFunc[0] = srcRGB;
+			m_blendFunc[1] = dstRGB;
+			m_blendFunc[2] = srcA;
+			m_blendFunc[3] = dstA;
+		}
+	}
+	unsigned int GLState::GetTexture(int unit)
+	{
+		bool cached = m_active && unit >= 0 && unit < GL_STATE_TEXTURE_UNITS;
+		if (cached && m_textures[unit] != -1)
+			return m_textures[unit];
+
+		// the query needs the unit to be active
+		ActiveTexture(unit);
+		GLint tex = 0;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D, &tex);
+		if (cached)
+			m_textures[unit] = tex;
+		return tex;
+	}
+	unsigned int GLState::GetFramebuffer(unsigned int target)
+	{
+		bool read = target == GL_READ_FRAMEBUFFER;
+		long long& cached = read ? m_readFBO : m_drawFBO;
+		if (m_active && cached != -1)
+			return cached;
+
+		GLint fbo = 0;
+		glGetIntegerv(read ? GL_READ_FRAMEBUFFER_BINDING : GL_DRAW_FRAMEBUFFER_BINDING, &fbo);
+		if (m_active)
+			cached = fbo;
+		return fbo;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include <Core/GPUProfiler.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include <GL/glew.h>
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+namespace gd
+{
+	GPUProfiler::GPUProfiler()
+	{
+		Enabled = false;
+		m_frame = 0;
+		m_inFrame = false;
+		for (int i = 0; i < GPU_PROFILER_FRAMES; i++)
+			m_frames[i].UsedQueries = 0;
+	}
+	GPUProfiler::~GPUProfiler()
+	{
+
+	}
+
+	void GPUProfiler::BeginFrame()
+	{
+		m_inFrame = false;
+		if (!Enabled || !(GLEW_VERSION_3_3 || GLEW_ARB_timer_query))
+			return;
+
+		// this frame's queries were issued GPU_PROFILER_FRAMES frames ago -> they should be done by now
+		m_frame = (m_frame + 1) % GPU_PROFILER_FRAMES;
+		Frame& frame = m_frames[m_frame];
+		m_collect(frame);
+		frame.UsedQueries = 0;
+		frame.Scopes.clear();
+
+		m_stack.clear();
+		m_inFrame = true;
+	}
+	void GPUProfiler::EndFrame()
+	{
+		while (m_inFrame && !m_stack.empty())
+			End();
+		m_inFrame = false;
+	}
+	void GPUProfiler::Begin(const char* name)
+	{
+		if (!m_inFrame)
+			return;
+
+		Frame& frame = m_frames[m_frame];
+
+		Scope scope;
+		scope.Name = m_stack.empty() ? std::string(name) : (frame.Scopes[m_stack.back()].Name + "/" + name);
+		scope.Depth = m_stack.size();
+		scope.StartQuery = m_getQuery();
+		scope.EndQuery = -1;
+		glQueryCounter(frame.Queries[scope.StartQuery], GL_TIMESTAMP);
+
+		m_stack.push_back(frame.Scopes.size());
+		frame.Scopes.push_back(scope);
+	}
+	void GPUProfiler::End()
+	{
+		if (!m_inFrame || m_stack.empty())
+			return;
+
+		Frame& frame = m_frames[m_frame];
+		Scope& scope = frame.Scopes[m_stack.back()];
+		scope.EndQuery = m_getQuery();
+		glQueryCounter(frame.Queries[scope.EndQuery], GL_TIMESTAMP);
+
+		m_stack.pop_back();
+	}
+
+	int GPUProfiler::m_getQuery()
+	{
+		Frame& frame = m_frames[m_frame];
+		if (frame.UsedQueries == frame.Queries.size()) {
+			unsigned int query = 0;
+			glGenQueries(1, &query);
+			frame.Queries.push_back(query);
+		}
+		return frame.UsedQueries++;
+	}
+	void GPUProfiler::m_collect(Frame& frame)
+	{
+		if (frame.UsedQueries == 0)
+			return;
+
+		// queries finish in order -> the last one tells if all of them are done
+		// the frame is dropped instead of waiting for the GPU
+		GLuint available = 0;
+		glGetQueryObjectuiv(frame.Queries[frame.UsedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return;
+
+		// scopes with the same name (multiple copies in one item, ...) are added together
+		std::unordered_map<std::string, float> times;
+		for (int i = 0; i < frame.Scopes.size(); i++) {
+			const Scope& scope = frame.Scopes[i];
+			if (scope.EndQuery < 0)
+				continue;
+
+			GLuint64 start = 0, end = 0;
+			glGetQueryObjectui64v(frame.Queries[scope.StartQuery], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(frame.Queries[scope.EndQuery], GL_QUERY_RESULT, &end);
+			float ms = end > start ? (end - start) / 1000000.0f : 0.0f;
+
+			if (times.count(scope.Name) == 0) {
+				History& hist = m_history[scope.Name];
+				if (hist.Samples.size() == 0)
+					hist.Next = 0;
+				hist.Depth = scope.Depth;
+				hist.Order = i;
+				times[scope.Name] = 0.0f;
+			}
+			times[scope.Name] += ms;
+		}
+
+		for (const auto& time : times) {
+			History& hist = m_history[time.first];
+			hist.Last = time.second;
+			if (hist.Samples.size() < GPU_PROFILER_HISTORY)
+				hist.Samples.push_back(time.second);
+			else
+				hist.Samples[hist.Next] = time.second;
+			hist.Next = (hist.Next + 1) % GPU_PROFILER_HISTORY;
+		}
+	}
+
+	std::vector<GPUProfiler::Stats> GPUProfiler::GetStats()
+	{
+		std::vector<std::pair<int, Stats>> sorted;
+		for (const auto& entry : m_history) {
+			const History& hist = entry.second;
+			if (hist.Samples.size() == 0)
+				continue;
+
+			Stats stats;
+			stats.Name = entry.first;
+			stats.Depth = hist.Depth;
+			stats.Last = hist.Last;
+			stats.Samples = hist.Samples.size();
+
+			std::vector<float> samples = hist.Samples;
+			std::sort(samples.begin(), samples.end());
+			float sum = 0.0f;
+			for (float s : samples)
+				sum += s;
+			stats.Min = samples.front();
+			stats.Avg = sum / samples.size();
+			stats.P99 = samples[std::min<size_t>(samples.size() - 1, (size_t)(samples.size() * 0.99f))];
+
+			sorted.push_back(std::make_pair(hist.Order, stats));
+		}
+
+		// execution order, names break the ties so that children stay after their parents
+		std::sort(sorted.begin(), sorted.end(), [](const std::pair<int, Stats>& a, const std::pair<int, Stats>& b) {
+			return a.first != b.first ? a.first < b.first : a.second.Name < b.second.Name;
+		});
+
+		std::vector<Stats> ret;
+		for (const auto& s : sorted)
+			ret.push_back(s.second);
+		return ret;
+	}
+	bool GPUProfiler::ExportCSV(const std::string& path)
+	{
+		std::ofstream file(path);
+		if (!file.is_open())
+			return false;
+
+		file << "name,samples,last_ms,min_ms,avg_ms,p99_ms\n";
+		for (const Stats& stats : GetStats())
+			file << "\"" << stats.Name << "\"," << stats.Samples << "," << stats.Last << "," << stats.Min << "," << stats.Avg << "," << stats.P99 << "\n";
+
+		return true;
+	}
+	void GPUProfiler::Reset()
+	{
+		m_inFrame = false;
+		m_stack.clear();
+		m_history.clear();
+		for (int i = 0; i < GPU_PROFILER_FRAMES; i++) {
+			m_frames[i].UsedQueries = 0;
+			m_frames[i].Scopes.clear();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#include <Core/PipelineOptimizer.h>
+#include <Core/CanvasMaterial.h>
+#include <Core/Sprite.h>
+
+namespace gd
+{
+	// blending where the order of the draws doesn't matter (also with clamping)
+	inline bool isCommutativeBlend(int mode)
+	{
+		return mode == Shader::CanvasItem::BLEND_MODE_ADD ||
+			mode == Shader::CanvasItem::BLEND_MODE_SUB ||
+			mode == Shader::CanvasItem::BLEND_MODE_MUL;
+	}
+	inline bool rectOverlaps(const glm::ivec4& a, const glm::ivec4& b)
+	{
+		return a.x < b.z && b.x < a.z && a.y < b.w && b.y < a.w;
+	}
+	inline unsigned int getTextureKey(pipe::CanvasMaterial* mat)
+	{
+		for (PipelineItem* item : mat->Items)
+			if (item->Type == PipelineItemType::Sprite && ((pipe::Sprite*)item)->IsVisible())
+				return ((pipe::Sprite*)item)->GetTextureID();
+		return 0;
+	}
+
+	PipelineOptimizer::PipelineOptimizer()
+	{
+		Enabled = false;
+		m_reordered = 0;
+		m_merged = 0;
+	}
+
+	void PipelineOptimizer::Build(const std::vector<PipelineItem*>& items)
+	{
+		Clear();
+		if (!Enabled)
+			return;
+
+		// BackBufferCopy items & materials that read the back buffer split the pipeline into runs
+		std::vector<pipe::CanvasMaterial*> run;
+		for (PipelineItem* item : items) {
+			if (item->Type == PipelineItemType::CanvasMaterial && m_canReorder((pipe::CanvasMaterial*)item)) {
+				run.push_back((pipe::CanvasMaterial*)item);
+				continue;
+			}
+
+			m_buildRun(run);
+			run.clear();
+		}
+		m_buildRun(run);
+	}
+	void PipelineOptimizer::Clear()
+	{
+		m_runs.clear();
+		m_itemRun.clear();
+		m_reordered = 0;
+		m_merged = 0;
+	}
+	const std::vector<PipelineOptimizer::DrawGroup>* PipelineOptimizer::GetRun(PipelineItem* item)
+	{
+		auto it = m_itemRun.find(item);
+		if (it == m_itemRun.end())
+			return nullptr;
+
+		Run& run = m_runs[it->second];
+		if (run.Drawn)
+			return &m_empty;
+
+		run.Drawn = true;
+		return &run.Groups;
+	}
+
+	bool PipelineOptimizer::m_canReorder(pipe::CanvasMaterial* mat)
+	{
+		return mat->HasProgram() && !mat->IsScreenTextureUsed();
+	}
+	void PipelineOptimizer::m_buildRun(const std::vector<pipe::CanvasMaterial*>& mats)
+	{
+		if (mats.size() < 2)
+			return;
+
+		size_t count = mats.size();
+		std::vector<glm::ivec4> bounds(count);
+		std::vector<bool> hasBounds(count);
+		std::vector<unsigned int> textures(count);
+		for (size_t i = 0; i < count; i++) {
+			hasBounds[i] = mats[i]->GetBounds(bounds[i]);
+			textures[i] = getTextureKey(mats[i]);
+		}
+
+		// i has to stay after j (j < i) if they overlap and their blending isn't commutative
+		std::vector<std::vector<int>> after(count);
+		std::vector<int> blockers(count, 0);
+		for (size_t i = 1; i < count; i++) {
+			for (size_t j = 0; j < i; j++) {
+				int blend = mats[i]->GetBlendMode();
+				if (blend == mats[j]->GetBlendMode() && isCommutativeBlend(blend))
+					continue;
+				if (hasBounds[i] && hasBounds[j] && !rectOverlaps(bounds[i], bounds[j]))
+					continue;
+
+				after[j].push_back(i);
+				blockers[i]++;
+			}
+		}
+
+		// pick the item that is closest to the last one, earliest wins ties -> pipeline order is kept if nothing can be gained
+		std::vector<int> order;
+		std::vector<bool> scheduled(count, false);
+		for (size_t n = 0; n < count; n++) {
+			int best = -1, bestScore = -1;
+			for (size_t i = 0; i < count; i++) {
+				if (scheduled[i] || blockers[i] > 0)
+					continue;
+
+				int score = 0;
+				if (!order.empty()) {
+					pipe::CanvasMaterial* last = mats[order.back()];
+					score += (mats[i]->GetProgram() == last->GetProgram()) * 4;
+					score += (textures[i] == textures[order.back()]) * 2;
+					score += (mats[i]->GetBlendMode() == last->GetBlendMode()) * 1;
+				}
+				if (score > bestScore) {
+					best = i;
+					bestScore = score;
+				}
+			}
+
+			scheduled[best] = true;
+			order.push_back(best);
+			for (int next : after[best])
+				blockers[next]--;
+		}
+
+		// neighbours with the same state share one Bind()
+		Run run;
+		run.Drawn = false;
+		for (size_t n = 0; n < count; n++) {
+			pipe::CanvasMaterial* mat = mats[order[n]];
+			if (order[n] != (int)n)
+				m_reordered++;
+
+			if (!run.Groups.empty()) {
+				pipe::CanvasMaterial* first = run.Groups.back().Materials[0];
+				if (first->DrawMode == mat->DrawMode && first->UseTextureAtlas == mat->UseTextureAtlas && first->HasSameState(mat)) {
+					run.Groups.back().Materials.push_back(mat);
+					m_merged++;
+					continue;
+				}
+			}
+
+			run.Groups.push_back(DrawGroup());
+			run.Groups.back().Materials.push_back(mat);
+		}
+
+		for (pipe::CanvasMaterial* mat : mats)
+			m_itemRun[mat] = m_runs.size();
+		m_runs.push_back(run);
+	}
+}
\ No newline at end of file
@@ -1,7 +1,14 @@
 #include <Core/ResourceManager.h>
+#include <Core/SpriteInstancer.h>
+#include <Core/GLState.h>
+#include <Core/FrameStats.h>
+#include <Core/GPUProfiler.h>
 #include <memory>
+#include <algorithm>
+#include <cstring>
 
 #include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <GL/glew.h>
 #if defined(__APPLE__)
@@ -11,6 +18,8 @@
 #endif
 
 #define EMPTY_TEXTURE_SIZE 128
+#define SCREEN_BLUR_MARGIN 6 // in source level pixels: 2 taps * 2 pixels + bilinear filtering + rounding
+#define SCREEN_TEXTURE_BUCKET 256 // SCREEN_TEXTURE size is rounded up to a multiple of this
 
 
 // vertex shader for copy, hblur and vblur shaders
@@ -51,17 +60,19 @@ in vec2 uv_interp;
 
 uniform sampler2D source; //texunit:0
 uniform vec2 pixel_size;
+uniform float lod; // source level
+uniform vec2 uv_max; // last visible source pixel, SCREEN_TEXTURE is pooled
 
 layout(location = 0) out vec4 frag_color;
 
 void main() {
-	vec4 color = textureLod(source, uv_interp, 0.0);
+	vec4 color = textureLod(source, min(uv_interp, uv_max), lod);
 
 	color *= 0.38774;
-	color += texture(source, uv_interp + vec2(1.0, 0.0) * pixel_size) * 0.24477;
-	color += texture(source, uv_interp + vec2(2.0, 0.0) * pixel_size) * 0.06136;
-	color += texture(source, uv_interp + vec2(-1.0, 0.0) * pixel_size) * 0.24477;
-	color += texture(source, uv_interp + vec2(-2.0, 0.0) * pixel_size) * 0.06136;
+	color += textureLod(source, min(uv_interp + vec2(1.0, 0.0) * pixel_size, uv_max), lod) * 0.24477;
+	color += textureLod(source, min(uv_interp + vec2(2.0, 0.0) * pixel_size, uv_max), lod) * 0.06136;
+	color += textureLod(source, min(uv_interp + vec2(-1.0, 0.0) * pixel_size, uv_max), lod) * 0.24477;
+	color += textureLod(source, min(uv_interp + vec2(-2.0, 0.0) * pixel_size, uv_max), lod) * 0.06136;
 
 	frag_color = color;
 }
@@ -73,22 +84,102 @@ in vec2 uv_interp;
 
 uniform sampler2D source; //texunit:0
 uniform vec2 pixel_size;
+uniform float lod; // source level
+uniform vec2 uv_max; // last visible source pixel, SCREEN_TEXTURE is pooled
 
 layout(location = 0) out vec4 frag_color;
 
 void main() {
-	vec4 color = textureLod(source, uv_interp, 0.0);
+	vec4 color = textureLod(source, min(uv_interp, uv_max), lod);
 
 	color *= 0.38774;
-	color += texture(source, uv_interp + vec2(0.0, 1.0) * pixel_size) * 0.24477;
-	color += texture(source, uv_interp + vec2(0.0, 2.0) * pixel_size) * 0.06136;
-	color += texture(source, uv_interp + vec2(0.0, -1.0) * pixel_size) * 0.24477;
-	color += texture(source, uv_interp + vec2(0.0, -2.0) * pixel_size) * 0.06136;
+	color += textureLod(source, min(uv_interp + vec2(0.0, 1.0) * pixel_size, uv_max), lod) * 0.24477;
+	color += textureLod(source, min(uv_interp + vec2(0.0, 2.0) * pixel_size, uv_max), lod) * 0.06136;
+	color += textureLod(source, min(uv_interp + vec2(0.0, -1.0) * pixel_size, uv_max), lod) * 0.24477;
+	color += textureLod(source, min(uv_interp + vec2(0.0, -2.0) * pixel_size, uv_max), lod) * 0.06136;
 
 	frag_color = color;
 }
 )";
 
+// horizontal & vertical blur in one pass, writes directly into the next SCREEN_TEXTURE level
+const char* PS_SHADER_FUSED_BLUR = R"(
+#version 330
+
+uniform sampler2D source; //texunit:0
+uniform vec2 pixel_size; // destination pixel size
+uniform float lod; // source level, relative to GL_TEXTURE_BASE_LEVEL
+uniform vec2 uv_max; // last visible source pixel, SCREEN_TEXTURE is pooled
+
+layout(location = 0) out vec4 frag_color;
+
+const float weights[5] = float[](0.06136, 0.24477, 0.38774, 0.24477, 0.06136);
+
+void main() {
+	vec2 pos = gl_FragCoord.xy;
+
+	vec4 color = vec4(0.0);
+	for (int y = -2; y <= 2; y++) {
+		float row = floor(pos.y) + float(y) + 0.5;
+
+		vec4 rowColor = vec4(0.0);
+		for (int x = -2; x <= 2; x++)
+			rowColor += textureLod(source, min(vec2(pos.x + float(x), row) * pixel_size, uv_max), lod) * weights[x + 2];
+		color += rowColor * weights[y + 2];
+	}
+
+	frag_color = color;
+}
+)";
+
+// compute version of the fused blur, horizontal pass results are kept in shared memory
+const char* CS_SHADER_BLUR = R"(
+#version 430
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D source; //texunit:0
+uniform float lod; // source level
+uniform ivec4 region; // destination pixels to update: xy = min, zw = max (exclusive)
+uniform vec2 uv_max; // last visible source pixel, SCREEN_TEXTURE is pooled
+layout(SCREEN_TEXTURE_FORMAT, binding = 0) writeonly uniform image2D destination;
+
+const float weights[5] = float[](0.06136, 0.24477, 0.38774, 0.24477, 0.06136);
+
+shared vec4 rows[12][8];
+
+void main() {
+	ivec2 size = imageSize(destination);
+	ivec2 tile = region.xy + ivec2(gl_WorkGroupID.xy) * 8;
+	ivec2 local = ivec2(gl_LocalInvocationID.xy);
+	vec2 pixel_size = 1.0 / vec2(size);
+
+	// horizontal pass for the tile + 2 rows above & below
+	for (int r = local.y; r < 12; r += 8) {
+		float row = float(tile.y + r - 2) + 0.5;
+		float x = float(tile.x + local.x) + 0.5;
+
+		vec4 color = vec4(0.0);
+		for (int k = -2; k <= 2; k++)
+			color += textureLod(source, min(vec2(x + float(k), row) * pixel_size, uv_max), lod) * weights[k + 2];
+		rows[r][local.x] = color;
+	}
+
+	barrier();
+
+	ivec2 pos = tile + local;
+	if (pos.x >= region.z || pos.y >= region.w)
+		return;
+
+	// vertical pass
+	vec4 color = vec4(0.0);
+	for (int k = 0; k < 5; k++)
+		color += rows[local.y + k][local.x] * weights[k];
+
+	imageStore(destination, pos, color);
+}
+)";
+
 
 
 namespace gd
@@ -136,16 +227,144 @@ namespace gd
 
 		return shader;
 	}
+	GLuint createComputeShader(const char* CS)
+	{
+		GLuint shader;
+
+		char infoLog[512] = { 0 };
+		GLint success = true;
+
+		// create compute shader
+		unsigned int shaderCS = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(shaderCS, 1, &CS, nullptr);
+		glCompileShader(shaderCS);
+		glGetShaderiv(shaderCS, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(shaderCS, 512, NULL, infoLog);
+			printf("Failed to compile a compute shader: %s\n", infoLog);
+		}
+
+		// create a shader program
+		shader = glCreateProgram();
+		glAttachShader(shader, shaderCS);
+		glLinkProgram(shader);
+		glGetProgramiv(shader, GL_LINK_STATUS, &success);
+		if (!success) {
+			glGetProgramInfoLog(shader, 512, NULL, infoLog);
+			printf("Failed to compile a shader program: %s\n", infoLog);
+			glDeleteProgram(shader);
+			shader = 0;
+		}
+
+		glDeleteShader(shaderCS);
+
+		return shader;
+	}
+
+	// rectangles: xy = min, zw = max (exclusive)
+	inline bool rectIsEmpty(const glm::ivec4& r) { return r.z <= r.x || r.w <= r.y; }
+	inline bool rectContains(const glm::ivec4& a, const glm::ivec4& b) { return rectIsEmpty(b) || (b.x >= a.x && b.y >= a.y && b.z <= a.z && b.w <= a.w); }
+	inline glm::ivec4 rectExpand(const glm::ivec4& r, int m) { return rectIsEmpty(r) ? r : glm::ivec4(r.x - m, r.y - m, r.z + m, r.w + m); }
+	inline glm::ivec4 rectIntersect(const glm::ivec4& a, const glm::ivec4& b)
+	{
+		glm::ivec4 ret(std::max(a.x, b.x), std::max(a.y, b.y), std::min(a.z, b.z), std::min(a.w, b.w));
+		return rectIsEmpty(ret) ? glm::ivec4(0) : ret;
+	}
+	inline glm::ivec4 rectUnion(const glm::ivec4& a, const glm::ivec4& b)
+	{
+		if (rectIsEmpty(a)) return b;
+		if (rectIsEmpty(b)) return a;
+		return glm::ivec4(std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.z, b.z), std::max(a.w, b.w));
+	}
+	inline GLenum getInternalFormat(ScreenTextureFormat fmt)
+	{
+		switch (fmt) {
+		case ScreenTextureFormat::RGB10_A2: return GL_RGB10_A2;
+		case ScreenTextureFormat::R11F_G11F_B10F: return GL_R11F_G11F_B10F;
+		case ScreenTextureFormat::RGBA16F: return GL_RGBA16F;
+		default: return GL_RGBA8;
+		}
+	}
+	inline const char* getImageFormat(ScreenTextureFormat fmt)
+	{
+		switch (fmt) {
+		case ScreenTextureFormat::RGB10_A2: return "rgb10_a2";
+		case ScreenTextureFormat::R11F_G11F_B10F: return "r11f_g11f_b10f";
+		case ScreenTextureFormat::RGBA16F: return "rgba16f";
+		default: return "rgba8";
+		}
+	}
+	inline int getBytesPerPixel(ScreenTextureFormat fmt) { return fmt == ScreenTextureFormat::RGBA16F ? 8 : 4; }
+	inline int getBucketSize(int size) { return std::max(1, (size + SCREEN_TEXTURE_BUCKET - 1) / SCREEN_TEXTURE_BUCKET) * SCREEN_TEXTURE_BUCKET; }
+	inline glm::ivec4 rectScale(const glm::ivec4& r, int level) // level 0 pixels -> level pixels, rounded outwards
+	{
+		int d = (1 << level) - 1;
+		return glm::ivec4(r.x >> level, r.y >> level, (r.z + d) >> level, (r.w + d) >> level);
+	}
+
 	struct QuadVertex
 	{
 		glm::vec4 Position;
 		glm::vec2 UV;
 	};
 
+	// the benchmarks run from the options window -> SHADERed's/ImGui's GL state has to survive them
+	struct HostGLState
+	{
+		GLint DrawFBO, ReadFBO, Program, VAO, ActiveUnit, Texture;
+		GLint Viewport[4], Scissor[4];
+		GLboolean Blend, ScissorTest;
+
+		void Save()
+		{
+			glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &DrawFBO);
+			glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &ReadFBO);
+			glGetIntegerv(GL_CURRENT_PROGRAM, &Program);
+			glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &VAO);
+			glGetIntegerv(GL_ACTIVE_TEXTURE, &ActiveUnit);
+			glActiveTexture(GL_TEXTURE0);
+			glGetIntegerv(GL_TEXTURE_BINDING_2D, &Texture);
+			glActiveTexture(ActiveUnit);
+			glGetIntegerv(GL_VIEWPORT, Viewport);
+			glGetIntegerv(GL_SCISSOR_BOX, Scissor);
+			Blend = glIsEnabled(GL_BLEND);
+			ScissorTest = glIsEnabled(GL_SCISSOR_TEST);
+		}
+		void Restore()
+		{
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, DrawFBO);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, ReadFBO);
+			glUseProgram(Program);
+			glBindVertexArray(VAO);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, Texture);
+			glActiveTexture(ActiveUnit);
+			glViewport(Viewport[0], Viewport[1], Viewport[2], Viewport[3]);
+			glScissor(Scissor[0], Scissor[1], Scissor[2], Scissor[3]);
+			if (Blend) glEnable(GL_BLEND);
+			else glDisable(GL_BLEND);
+			if (ScissorTest) glEnable(GL_SCISSOR_TEST);
+			else glDisable(GL_SCISSOR_TEST);
+
+			GLState::Instance().Invalidate();
+		}
+	};
+
 	ResourceManager::ResourceManager()
 	{
 		EmptyTexture = 0;
-		CopiedScreenTexture = false;
+		m_snapshots.resize(1);
+		m_snapshots[0].InUse = true;
+		m_blurMipmaps.Color = 0;
+		m_blurMipmaps.Levels = 0;
+		m_snapshot = 0;
+		FastScreenCopy = true;
+		m_copySource = 0;
+		m_copySourceMatches = false;
+		m_copySourceFormat = 0;
+		m_format = ScreenTextureFormat::RGBA8;
+		m_poolWidth = m_poolHeight = 0;
+		m_exactScreenSize = false;
 		m_createEmptyTexture();
 		m_createBlackTexture();
 		m_createWhiteTexture();
@@ -193,6 +412,9 @@ void main()
 	frag_color = color_interp * texture(color_texture, uv_interp);
 }
 )";
+
+		// default canvas item vertex shader that reads sprite data from the instance attributes
+		m_canvasInstancedVS = SpriteInstancer::CreateInstancedVertexShader(m_canvasVS);
 	}
 	ResourceManager::~ResourceManager()
 	{
@@ -205,57 +427,238 @@ void main()
 
 		// TODO: other resources
 	}
-	void ResourceManager::Copy(unsigned int colorBuffer, unsigned int curFBO)
+	void ResourceManager::Copy(unsigned int colorBuffer, unsigned int curFBO, int levels, const glm::ivec4* region, int snapshot)
 	{
-		if (m_mipmapData[0].Sizes.size() == 0 || CopiedScreenTexture)
+		if (snapshot < 0 || snapshot >= m_snapshots.size() || m_snapshots[snapshot].Mipmaps.Sizes.size() == 0)
+			return;
+
+		// the blur helpers work on this snapshot
+		m_snapshot = snapshot;
+		Snapshot& snap = m_snapshots[snapshot];
+		MipmapData& mips = snap.Mipmaps;
+
+		int maxLevels = m_blurMipmaps.Sizes.size();
+		if (levels < 0 || levels > maxLevels)
+			levels = maxLevels;
+
+		if (!snap.Copied) {
+			snap.CopiedLevels = 0;
+			for (auto& rect : snap.CopiedRegions)
+				rect = glm::ivec4(0);
+		}
+
+		// region that has to be valid at each level, blur taps need a margin from the previous level
+		glm::ivec4 screen(0, 0, m_rtw, m_rth);
+		glm::ivec4 need = region ? rectIntersect(*region, screen) : screen;
+		if (m_requiredRegions.size() < levels + 1)
+			m_requiredRegions.resize(levels + 1); // only if Copy() runs before the first resize
+		std::vector<glm::ivec4>& required = m_requiredRegions;
+		for (int i = levels; i >= 0; i--) {
+			// blurred levels also get one pixel past the visible part -> bilinear reads at the edge stay valid
+			const MipmapSize& size = mips.Sizes[i];
+			const MipmapSize& pool = mips.Pool[i];
+			int pad = i > 0 ? 1 : 0;
+			glm::ivec4 bounds(0, 0, std::min(size.Width + pad, pool.Width), std::min(size.Height + pad, pool.Height));
+
+			glm::ivec4 rect = rectIntersect(rectScale(need, i), bounds);
+			if (i < levels)
+				rect = rectUnion(rect, rectIntersect(rectExpand(required[i + 1] * 2, SCREEN_BLUR_MARGIN), bounds));
+			required[i] = rect;
+		}
+
+		// the blurred levels are only generated when some shader needs them
+		bool isCopied = snap.Copied && levels <= snap.CopiedLevels;
+		for (int i = 0; i <= levels && isCopied; i++)
+			isCopied = rectContains(snap.CopiedRegions[i], required[i]);
+		if (isCopied)
 			return;
 
-		CopiedScreenTexture = true;
+		GPUProfiler& profiler = GPUProfiler::Instance();
+		profiler.Begin("SCREEN_TEXTURE copy");
+		FrameStats::Instance().Add(FrameCounter::ScreenCopies);
+
+		GLState::Instance().Enable(GL_BLEND, false);
+
+		bool scissorEnabled = GLState::Instance().IsEnabled(GL_SCISSOR_TEST);
+		GLState::Instance().Enable(GL_SCISSOR_TEST, true);
+
+		// level 0 -> only copy the parts that weren't copied yet, the rest might already be overdrawn
+		if (!rectContains(snap.CopiedRegions[0], required[0])) {
+			glm::ivec4 old = snap.CopiedRegions[0];
+			glm::ivec4 full = rectUnion(old, required[0]);
+
+			ScreenCopyMethod method = GetScreenCopyMethod(colorBuffer);
+			if (method == ScreenCopyMethod::Blit) {
+				GLState::Instance().BindFramebuffer(GL_READ_FRAMEBUFFER, curFBO);
+				GLState::Instance().BindFramebuffer(GL_DRAW_FRAMEBUFFER, mips.Sizes[0].FBO);
+			} else if (method == ScreenCopyMethod::Shader) {
+				GLState::Instance().BindFramebuffer(GL_FRAMEBUFFER, mips.Sizes[0].FBO);
+				GLState::Instance().Viewport(0, 0, m_rtw, m_rth);
+				GLState::Instance().BindTexture(0, colorBuffer);
+				GLState::Instance().UseProgram(m_copyShader);
+			}
+
+			if (rectIsEmpty(old))
+				m_copyRegion(method, colorBuffer, full);
+			else {
+				glm::ivec4 strips[4] = {
+					glm::ivec4(full.x, full.y, full.z, old.y),	// bottom
+					glm::ivec4(full.x, old.w, full.z, full.w),	// top
+					glm::ivec4(full.x, old.y, old.x, old.w),	// left
+					glm::ivec4(old.z, old.y, full.z, old.w)		// right
+				};
+				for (const auto& strip : strips)
+					if (!rectIsEmpty(strip))
+						m_copyRegion(method, colorBuffer, strip);
+			}
+
+			snap.CopiedRegions[0] = full;
+		}
+		snap.Copied = true;
+
+		GLState::Instance().SelectTexture(0, mips.Color);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips.Levels);
+
+		for (int i = 1; i <= levels; i++) {
+			if (i <= snap.CopiedLevels && rectContains(snap.CopiedRegions[i], required[i]))
+				continue;
+
+			glm::ivec4 rect = required[i];
+			if (i <= snap.CopiedLevels)
+				rect = rectUnion(rect, snap.CopiedRegions[i]);
+
+			if (profiler.IsRecording())
+				profiler.Begin(("level " + std::to_string(i)).c_str());
+			if (Downsample == DownsampleMode::Compute && m_computeBlurShader != 0) {
+				m_downsampleCompute(i - 1, rect);
+				FrameStats::Instance().Add(FrameCounter::BlurPasses);
+			} else if (Downsample == DownsampleMode::FusedFragment) {
+				m_downsampleFused(i - 1, rect);
+				FrameStats::Instance().Add(FrameCounter::BlurPasses);
+			} else {
+				m_downsample(i - 1, rect);
+				FrameStats::Instance().Add(FrameCounter::BlurPasses, 2);
+			}
+			profiler.End();
+
+			snap.CopiedRegions[i] = rect;
+		}
+		snap.CopiedLevels = std::max<int>(snap.CopiedLevels, levels);
+
+		// never sample the levels that weren't updated
+		GLState::Instance().SelectTexture(0, mips.Color);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, snap.CopiedLevels);
+
+		if (!scissorEnabled)
+			GLState::Instance().Enable(GL_SCISSOR_TEST, false);
+
+		GLState::Instance().BindFramebuffer(GL_FRAMEBUFFER, curFBO); //back to front
+		GLState::Instance().Viewport(0, 0, m_rtw, m_rth);
 
-		glDisable(GL_BLEND);
+		GLState::Instance().Enable(GL_BLEND, true);
 
-		glm::vec2 wh(m_rtw, m_rth);
+		profiler.End();
+	}
+
+	void ResourceManager::m_downsample(int level, const glm::ivec4& rect)
+	{
+		MipmapData& mips = m_snapshots[m_snapshot].Mipmaps;
+		// two passes & two FBOs per level, viewport covers the whole pooled level
+		int vp_w = m_blurMipmaps.Pool[level].Width;
+		int vp_h = m_blurMipmaps.Pool[level].Height;
+		GLState::Instance().Viewport(0, 0, vp_w, vp_h);
+
+		//horizontal pass -> vertical pass reads 2 more rows above & below
+		glm::ivec4 hrect = rectIntersect(glm::ivec4(rect.x, rect.y - 2, rect.z, rect.w + 2), glm::ivec4(0, 0, vp_w, vp_h));
+		glScissor(hrect.x, hrect.y, hrect.z - hrect.x, hrect.w - hrect.y);
 
-		glBindFramebuffer(GL_FRAMEBUFFER, m_mipmapData[0].Sizes[0].FBO);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, colorBuffer);
+		GLState::Instance().UseProgram(m_horizontalBlurShader);
 
-		glUseProgram(m_copyShader);
+		glUniform2f(m_hblurPixelSizeUniform, 1.0f / vp_w, 1.0 / vp_h);
+		glUniform1f(m_hblurLodUniform, level);
+		glUniform2fv(m_hblurUVMaxUniform, 1, glm::value_ptr(m_getUVMax(mips, level)));
+		GLState::Instance().BindTexture(0, mips.Color); //previous level, since mipmaps[0] starts one level bigger
+		GLState::Instance().BindFramebuffer(GL_FRAMEBUFFER, m_blurMipmaps.Sizes[level].FBO);
 
 		m_copyScreen();
 
-		for (int i = 0; i < m_mipmapData[1].Sizes.size(); i++) {
-			int vp_w = m_mipmapData[1].Sizes[i].Width;
-			int vp_h = m_mipmapData[1].Sizes[i].Height;
-			glViewport(0, 0, vp_w, vp_h);
 
-			//horizontal pass
-			glUseProgram(m_horizontalBlurShader);
+		//vertical pass
+		glScissor(rect.x, rect.y, rect.z - rect.x, rect.w - rect.y);
 
-			glUniform2f(m_hblurPixelSizeUniform, 1.0f / vp_w, 1.0 / vp_h);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, m_mipmapData[0].Color); //previous level, since mipmaps[0] starts one level bigger
-			glBindFramebuffer(GL_FRAMEBUFFER, m_mipmapData[1].Sizes[i].FBO);
+		GLState::Instance().UseProgram(m_verticalBlurShader);
+		glUniform2f(m_vblurPixelSizeUniform, 1.0f / vp_w, 1.0 / vp_h);
+		glUniform1f(m_vblurLodUniform, level);
+		glUniform2fv(m_vblurUVMaxUniform, 1, glm::value_ptr(m_getUVMax(m_blurMipmaps, level)));
+		GLState::Instance().BindTexture(0, m_blurMipmaps.Color);
+		GLState::Instance().BindFramebuffer(GL_FRAMEBUFFER, mips.Sizes[level + 1].FBO); //next level, since mipmaps[0] starts one level bigger
 
-			m_copyScreen();
+		m_copyScreen();
+	}
+	void ResourceManager::m_downsampleFused(int level, const glm::ivec4& rect)
+	{
+		MipmapData& mips = m_snapshots[m_snapshot].Mipmaps;
+		// one pass per level, no intermediate texture
+		const MipmapSize& dst = mips.Pool[level + 1];
+		GLState::Instance().Viewport(0, 0, dst.Width, dst.Height);
+		glScissor(rect.x, rect.y, rect.z - rect.x, rect.w - rect.y);
+		GLState::Instance().BindFramebuffer(GL_FRAMEBUFFER, dst.FBO);
 
+		GLState::Instance().UseProgram(m_fusedBlurShader);
 
-			//vertical pass
-			glUseProgram(m_verticalBlurShader);
-			glUniform2f(m_vblurPixelSizeUniform, 1.0f / vp_w, 1.0 / vp_h);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, m_mipmapData[1].Color);
-			glBindFramebuffer(GL_FRAMEBUFFER, m_mipmapData[0].Sizes[i + 1].FBO); //next level, since mipmaps[0] starts one level bigger
+		// level + 1 is attached to the FBO -> only the source level may be sampled, otherwise it's a feedback loop
+		GLState::Instance().SelectTexture(0, mips.Color);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level);
 
-			m_copyScreen();
-		}
+		glUniform2f(m_fusedBlurPixelSizeUniform, 1.0f / dst.Width, 1.0f / dst.Height);
+		glUniform1f(m_fusedBlurLodUniform, 0.0f); // relative to the base level
+		glUniform2fv(m_fusedBlurUVMaxUniform, 1, glm::value_ptr(m_getUVMax(mips, level)));
 
-		glBindFramebuffer(GL_FRAMEBUFFER, curFBO); //back to front
-		glViewport(0, 0, m_rtw, m_rth);
+		m_copyScreen();
 
-		glEnable(GL_BLEND);
+		GLState::Instance().SelectTexture(0, mips.Color);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, mips.Levels);
+	}
+	void ResourceManager::m_downsampleCompute(int level, const glm::ivec4& rect)
+	{
+		MipmapData& mips = m_snapshots[m_snapshot].Mipmaps;
+		// one dispatch per level, every level needs the previous one
+		GLState::Instance().UseProgram(m_computeBlurShader);
+		GLState::Instance().BindTexture(0, mips.Color);
+
+		glUniform1f(m_computeBlurLodUniform, level);
+		glUniform2fv(m_computeBlurUVMaxUniform, 1, glm::value_ptr(m_getUVMax(mips, level)));
+		glUniform4i(m_computeBlurRegionUniform, rect.x, rect.y, rect.z, rect.w);
+		glBindImageTexture(0, mips.Color, level + 1, GL_FALSE, 0, GL_WRITE_ONLY, getInternalFormat(m_format));
+		glDispatchCompute((rect.z - rect.x + 7) / 8, (rect.w - rect.y + 7) / 8, 1);
+		FrameStats::Instance().Add(FrameCounter::DrawCalls);
+
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+		glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, getInternalFormat(m_format));
 	}
 
+	void ResourceManager::m_createComputeBlur()
+	{
+		if (m_computeBlurShader != 0)
+			glDeleteProgram(m_computeBlurShader);
+		m_computeBlurShader = 0;
+
+		// compute shaders: GL 4.3 or ARB_compute_shader + image load/store
+		if (!(GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_image_load_store)))
+			return;
+
+		// image layout has to match the SCREEN_TEXTURE format
+		std::string source = CS_SHADER_BLUR;
+		size_t formatPos = source.find("SCREEN_TEXTURE_FORMAT");
+		source.replace(formatPos, strlen("SCREEN_TEXTURE_FORMAT"), getImageFormat(m_format));
+
+		m_computeBlurShader = createComputeShader(source.c_str());
+		m_computeBlurLodUniform = glGetUniformLocation(m_computeBlurShader, "lod");
+		m_computeBlurRegionUniform = glGetUniformLocation(m_computeBlurShader, "region");
+		m_computeBlurUVMaxUniform = glGetUniformLocation(m_computeBlurShader, "uv_max");
+	}
 	void ResourceManager::m_createMipmapResources()
 	{
 		m_copyShader = createShader(VS_SHADER_COPY, PS_SHADER_COPY);
@@ -264,6 +667,19 @@ void main()
 
 		m_hblurPixelSizeUniform = glGetUniformLocation(m_horizontalBlurShader, "pixel_size");
 		m_vblurPixelSizeUniform = glGetUniformLocation(m_verticalBlurShader, "pixel_size");
+		m_hblurLodUniform = glGetUniformLocation(m_horizontalBlurShader, "lod");
+		m_vblurLodUniform = glGetUniformLocation(m_verticalBlurShader, "lod");
+		m_hblurUVMaxUniform = glGetUniformLocation(m_horizontalBlurShader, "uv_max");
+		m_vblurUVMaxUniform = glGetUniformLocation(m_verticalBlurShader, "uv_max");
+
+		m_fusedBlurShader = createShader(VS_SHADER_COPY, PS_SHADER_FUSED_BLUR);
+		m_fusedBlurPixelSizeUniform = glGetUniformLocation(m_fusedBlurShader, "pixel_size");
+		m_fusedBlurLodUniform = glGetUniformLocation(m_fusedBlurShader, "lod");
+		m_fusedBlurUVMaxUniform = glGetUniformLocation(m_fusedBlurShader, "uv_max");
+
+		m_computeBlurShader = 0;
+		m_createComputeBlur();
+		Downsample = m_computeBlurShader != 0 ? DownsampleMode::Compute : DownsampleMode::FusedFragment;
 
 		QuadVertex verts[6];
 		verts[0] = { {-1.0f, -1.0f, 0.0f, 1.0f},		{0.0f, 0.0f} };
@@ -275,7 +691,7 @@ void main()
 
 		// create vao
 		glGenVertexArrays(1, &m_quadVAO);
-		glBindVertexArray(m_quadVAO);
+		GLState::Instance().BindVertexArray(m_quadVAO);
 
 		// create vbo
 		glGenBuffers(1, &m_quadVBO);
@@ -292,113 +708,427 @@ void main()
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void*)(4 * sizeof(GLfloat)));
 		glEnableVertexAttribArray(1);
 
-		glBindVertexArray(0);
+		GLState::Instance().BindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 	void ResourceManager::m_createMipmaps(int rtw, int rth)
 	{
-		glDeleteTextures(1, &m_mipmapData[0].Color);
-		for (int i = 0; i < m_mipmapData[0].Sizes.size(); i++)
-			glDeleteFramebuffers(1, &m_mipmapData[0].Sizes[i].FBO);
-		glDeleteTextures(1, &m_mipmapData[1].Color);
-		for (int i = 0; i < m_mipmapData[1].Sizes.size(); i++)
-			glDeleteFramebuffers(1, &m_mipmapData[1].Sizes[i].FBO);
-
-		m_mipmapData[0].Sizes.clear();
-		m_mipmapData[1].Sizes.clear();
+		// reuse the pooled textures while the viewport fits in them & doesn't waste too much memory
+		int bucketW = m_exactScreenSize ? rtw : getBucketSize(rtw);
+		int bucketH = m_exactScreenSize ? rth : getBucketSize(rth);
+		bool fits = m_snapshots[0].Mipmaps.Pool.size() > 0 &&
+			rtw <= m_poolWidth && rth <= m_poolHeight &&
+			m_poolWidth <= bucketW * 2 && m_poolHeight <= bucketH * 2;
+		if (m_exactScreenSize)
+			fits = fits && rtw == m_poolWidth && rth == m_poolHeight;
+		if (!fits)
+			m_allocateMipmaps(bucketW, bucketH);
 
 		m_rtw = rtw;
 		m_rth = rth;
 
+		m_setVisibleSize(m_blurMipmaps, rtw >> 1, rth >> 1);
+		for (auto& snap : m_snapshots) {
+			m_setVisibleSize(snap.Mipmaps, rtw, rth);
+
+			// nothing is copied to the new textures yet
+			snap.CopiedRegions.assign(snap.Mipmaps.Sizes.size(), glm::ivec4(0));
+			snap.CopiedLevels = 0;
+			snap.Copied = false;
+		}
+		m_requiredRegions.resize(m_snapshots[0].Mipmaps.Sizes.size());
+
+		// window color buffer is resized too -> check its format again
+		m_copySource = 0;
+	}
+	void ResourceManager::m_allocateMipmaps(int poolW, int poolH)
+	{
+		m_poolWidth = poolW;
+		m_poolHeight = poolH;
+
 		if (m_mipmapDepth == 0)
 			glGenTextures(1, &m_mipmapDepth);
-		glBindTexture(GL_TEXTURE_2D, m_mipmapDepth);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, rtw, rth, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+		GLState::Instance().SelectTexture(0, m_mipmapDepth);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, poolW, poolH, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		GLuint color_internal_format = GL_RGBA8;
-		if (rtw >= 2 && rth >= 2) {
-			for (int i = 0; i < 2; i++) {
-				int w = rtw;
-				int h = rth;
-
-				if (i > 0) {
-					w >>= 1;
-					h >>= 1;
-				}
-
-				glGenTextures(1, &m_mipmapData[i].Color);
-				glBindTexture(GL_TEXTURE_2D, m_mipmapData[i].Color);
-
-				int level = 0;
-				int fb_w = w;
-				int fb_h = h;
-
-				while (true) {
-					MipmapSize mm;
-					mm.Width = w;
-					mm.Height = h;
-					m_mipmapData[i].Sizes.push_back(mm);
-
-					w >>= 1;
-					h >>= 1;
-
-					if (w < 2 || h < 2)
-						break;
-
-					level++;
-				}
-
-				glTexStorage2D(GL_TEXTURE_2D, level+1, color_internal_format, fb_w, fb_h);
-
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level);
-				glDisable(GL_SCISSOR_TEST);
-				glColorMask(1, 1, 1, 1);
-				
-				for (int j = 0; j < m_mipmapData[i].Sizes.size(); j++) {
-
-					MipmapSize& mm = m_mipmapData[i].Sizes[j];
-
-					glGenFramebuffers(1, &mm.FBO);
-					glBindFramebuffer(GL_FRAMEBUFFER, mm.FBO);
-					glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_mipmapData[i].Color, j);
-					bool used_depth = false;
-					if (j == 0 && i == 0) { //use always
-						glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_mipmapDepth, 0);
-						used_depth = true;
-					}
-
-					GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-					if (status != GL_FRAMEBUFFER_COMPLETE) {
-						printf("Failed to create SCREEN_TEXTURE FBO!\n");
-					}
-
-					float zero[4] = { 1, 0, 1, 0 };
-					glViewport(0, 0, m_mipmapData[i].Sizes[j].Width, m_mipmapData[i].Sizes[j].Height);
-					glClearBufferfv(GL_COLOR, 0, zero);
-					if (used_depth) {
-						glClearDepth(1.0);
-						glClear(GL_DEPTH_BUFFER_BIT);
-					}
-				}
-
-				glBindFramebuffer(GL_FRAMEBUFFER, 0);
-				m_mipmapData[i].Levels = level;
-
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-				glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		GLState::Instance().BindTexture(0, 0);
+
+		m_allocateLevels(m_blurMipmaps, poolW >> 1, poolH >> 1, false);
+
+		// snapshots that aren't used in this frame are recreated when they are acquired again
+		m_allocateLevels(m_snapshots[0].Mipmaps, poolW, poolH, true);
+		for (int i = 1; i < m_snapshots.size(); i++)
+			m_allocateLevels(m_snapshots[i].Mipmaps, m_snapshots[i].InUse ? poolW : 0, m_snapshots[i].InUse ? poolH : 0, false);
+	}
+	void ResourceManager::m_allocateLevels(MipmapData& data, int w, int h, bool depth)
+	{
+		glDeleteTextures(1, &data.Color);
+		for (int i = 0; i < data.Pool.size(); i++)
+			glDeleteFramebuffers(1, &data.Pool[i].FBO);
+
+		data.Pool.clear();
+		data.Sizes.clear();
+		data.Color = 0;
+		data.Levels = 0;
+
+		if (w < 2 || h < 2)
+			return;
+
+		GLuint color_internal_format = getInternalFormat(m_format);
+
+		glGenTextures(1, &data.Color);
+		GLState::Instance().SelectTexture(0, data.Color);
+
+		int level = 0;
+		int fb_w = w;
+		int fb_h = h;
+
+		while (true) {
+			MipmapSize mm;
+			mm.Width = w;
+			mm.Height = h;
+			data.Pool.push_back(mm);
+
+			w >>= 1;
+			h >>= 1;
+
+			if (w < 2 || h < 2)
+				break;
+
+			level++;
+		}
+
+		glTexStorage2D(GL_TEXTURE_2D, level+1, color_internal_format, fb_w, fb_h);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level);
+		GLState::Instance().Enable(GL_SCISSOR_TEST, false);
+		glColorMask(1, 1, 1, 1);
+		
+		for (int j = 0; j < data.Pool.size(); j++) {
+
+			MipmapSize& mm = data.Pool[j];
+
+			glGenFramebuffers(1, &mm.FBO);
+			GLState::Instance().BindFramebuffer(GL_FRAMEBUFFER, mm.FBO);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, data.Color, j);
+			bool used_depth = false;
+			if (j == 0 && depth) { //use always
+				glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_mipmapDepth, 0);
+				used_depth = true;
 			}
+
+			GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+			if (status != GL_FRAMEBUFFER_COMPLETE) {
+				printf("Failed to create SCREEN_TEXTURE FBO!\n");
+			}
+
+			float zero[4] = { 1, 0, 1, 0 };
+			GLState::Instance().Viewport(0, 0, mm.Width, mm.Height);
+			glClearBufferfv(GL_COLOR, 0, zero);
+			if (used_depth) {
+				glClearDepth(1.0);
+				glClear(GL_DEPTH_BUFFER_BIT);
+			}
+		}
+
+		GLState::Instance().BindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	void ResourceManager::m_setVisibleSize(MipmapData& data, int w, int h)
+	{
+		data.Sizes.clear();
+		data.Levels = 0;
+
+		if (w < 2 || h < 2 || data.Pool.size() == 0)
+			return;
+
+		// visible part of each pooled level
+		int level = 0;
+		while (level < data.Pool.size()) {
+			MipmapSize mm;
+			mm.Width = w;
+			mm.Height = h;
+			mm.FBO = data.Pool[level].FBO;
+			data.Sizes.push_back(mm);
+
+			w >>= 1;
+			h >>= 1;
+
+			if (w < 2 || h < 2)
+				break;
+
+			level++;
 		}
+		data.Levels = data.Sizes.size() - 1;
+
+		GLState::Instance().SelectTexture(0, data.Color);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, data.Levels);
+		GLState::Instance().BindTexture(0, 0);
+	}
+	int ResourceManager::AcquireSnapshot()
+	{
+		int index = 1;
+		while (index < m_snapshots.size() && m_snapshots[index].InUse)
+			index++;
+		if (index == m_snapshots.size())
+			m_snapshots.push_back(Snapshot());
+
+		Snapshot& snap = m_snapshots[index];
+		snap.InUse = true;
+
+		// pooled snapshots are dropped when SCREEN_TEXTURE is reallocated
+		if (snap.Mipmaps.Pool.size() == 0 && m_poolWidth > 0) {
+			m_allocateLevels(snap.Mipmaps, m_poolWidth, m_poolHeight, false);
+			m_setVisibleSize(snap.Mipmaps, m_rtw, m_rth);
+		}
+
+		snap.CopiedRegions.assign(snap.Mipmaps.Sizes.size(), glm::ivec4(0));
+		snap.CopiedLevels = 0;
+		snap.Copied = false;
+
+		return index;
+	}
+	void ResourceManager::ReleaseSnapshot(int snapshot)
+	{
+		if (snapshot > 0 && snapshot < m_snapshots.size())
+			m_snapshots[snapshot].InUse = false;
+	}
+	void ResourceManager::ReleaseSnapshots()
+	{
+		for (int i = 1; i < m_snapshots.size(); i++)
+			m_snapshots[i].InUse = false;
+	}
+	void ResourceManager::InvalidateSnapshot(int snapshot)
+	{
+		if (snapshot >= 0 && snapshot < m_snapshots.size())
+			m_snapshots[snapshot].Copied = false;
+	}
+	void ResourceManager::CaptureSnapshot(int snapshot, unsigned int colorBuffer, unsigned int curFBO)
+	{
+		// only the first level is copied now, blurred levels are generated from it when they are sampled
+		InvalidateSnapshot(snapshot);
+		Copy(colorBuffer, curFBO, 0, nullptr, snapshot);
+	}
+	glm::vec2 ResourceManager::m_getUVMax(const MipmapData& mips, int level)
+	{
+		// blur passes clamp their taps to the visible part of the source level
+		const MipmapSize& size = mips.Sizes[level];
+		const MipmapSize& pool = mips.Pool[level];
+		return glm::vec2((size.Width - 0.5f) / pool.Width, (size.Height - 0.5f) / pool.Height);
+	}
+	glm::vec2 ResourceManager::GetScreenUVScale()
+	{
+		if (m_poolWidth == 0 || m_poolHeight == 0)
+			return glm::vec2(1.0f);
+		return glm::vec2((float)m_rtw / m_poolWidth, (float)m_rth / m_poolHeight);
+	}
+	glm::vec2 ResourceManager::GetScreenUVMax()
+	{
+		// center of the last visible pixel, the rest of the pooled texture holds old data
+		if (m_poolWidth == 0 || m_poolHeight == 0)
+			return glm::vec2(1.0f);
+		return glm::vec2((m_rtw - 0.5f) / m_poolWidth, (m_rth - 0.5f) / m_poolHeight);
 	}
 	void ResourceManager::m_copyScreen()
 	{
-		glBindVertexArray(m_quadVAO);
+		GLState::Instance().BindVertexArray(m_quadVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
+		FrameStats::Instance().Add(FrameCounter::DrawCalls);
+	}
+	void ResourceManager::m_copyRegion(ScreenCopyMethod method, unsigned int colorBuffer, const glm::ivec4& rect)
+	{
+		int w = rect.z - rect.x, h = rect.w - rect.y;
+
+		if (method == ScreenCopyMethod::CopyImage)
+			glCopyImageSubData(colorBuffer, GL_TEXTURE_2D, 0, rect.x, rect.y, 0,
+				m_snapshots[m_snapshot].Mipmaps.Color, GL_TEXTURE_2D, 0, rect.x, rect.y, 0, w, h, 1);
+		else if (method == ScreenCopyMethod::Blit) {
+			glScissor(rect.x, rect.y, w, h);
+			glBlitFramebuffer(rect.x, rect.y, rect.z, rect.w, rect.x, rect.y, rect.z, rect.w, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		} else {
+			glScissor(rect.x, rect.y, w, h);
+			m_copyScreen();
+		}
+	}
+	ScreenCopyMethod ResourceManager::GetScreenCopyMethod(unsigned int colorBuffer)
+	{
+		if (!FastScreenCopy || m_snapshots[0].Mipmaps.Sizes.size() == 0)
+			return ScreenCopyMethod::Shader;
+
+		// blit & copy don't scale -> color buffer has to be as big as the first level
+		if (m_copySource != colorBuffer) {
+			GLint format = 0, w = 0, h = 0;
+			GLState::Instance().SelectTexture(0, colorBuffer);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+			GLState::Instance().BindTexture(0, 0);
+
+			m_copySource = colorBuffer;
+			m_copySourceFormat = format == GL_RGBA ? GL_RGBA8 : format;
+			m_copySourceMatches = w == m_rtw && h == m_rth;
+		}
+
+		if (!m_copySourceMatches)
+			return ScreenCopyMethod::Shader;
+
+		// glCopyImageSubData copies raw texels, glBlitFramebuffer can convert between normalized & float formats
+		if (m_copySourceFormat == getInternalFormat(m_format) && (GLEW_VERSION_4_3 || GLEW_ARB_copy_image))
+			return ScreenCopyMethod::CopyImage;
+		return ScreenCopyMethod::Blit;
+	}
+	std::string ResourceManager::BenchmarkScreenCopy(unsigned int colorBuffer, unsigned int curFBO, int iterations)
+	{
+		if (m_snapshots[0].Mipmaps.Sizes.size() == 0)
+			return "SCREEN_TEXTURE isn't created yet";
+
+		HostGLState host;
+		host.Save();
+
+		ScreenCopyMethod best = GetScreenCopyMethod(colorBuffer);
+		ScreenCopyMethod methods[3] = { ScreenCopyMethod::Shader, ScreenCopyMethod::Blit, ScreenCopyMethod::CopyImage };
+		const char* names[3] = { "shader", "blit", "copy image" };
+		glm::ivec4 screen(0, 0, m_rtw, m_rth);
+		m_snapshot = 0;
+
+		GLuint query;
+		glGenQueries(1, &query);
+
+		GLState::Instance().Enable(GL_BLEND, false);
+		bool scissorEnabled = GLState::Instance().IsEnabled(GL_SCISSOR_TEST);
+		GLState::Instance().Enable(GL_SCISSOR_TEST, true);
+
+		std::string report = "SCREEN_TEXTURE copy (" + std::to_string(m_rtw) + "x" + std::to_string(m_rth) + ", " + std::to_string(iterations) + " iterations):";
+		for (int i = 0; i < 3; i++) {
+			// the fast paths can only be used when the sizes match
+			if (methods[i] != ScreenCopyMethod::Shader && best == ScreenCopyMethod::Shader)
+				continue;
+			if (methods[i] == ScreenCopyMethod::CopyImage && best != ScreenCopyMethod::CopyImage)
+				continue;
+
+			if (methods[i] == ScreenCopyMethod::Blit) {
+				GLState::Instance().BindFramebuffer(GL_READ_FRAMEBUFFER, curFBO);
+				GLState::Instance().BindFramebuffer(GL_DRAW_FRAMEBUFFER, m_snapshots[0].Mipmaps.Sizes[0].FBO);
+			} else if (methods[i] == ScreenCopyMethod::Shader) {
+				GLState::Instance().BindFramebuffer(GL_FRAMEBUFFER, m_snapshots[0].Mipmaps.Sizes[0].FBO);
+				GLState::Instance().Viewport(0, 0, m_rtw, m_rth);
+				GLState::Instance().BindTexture(0, colorBuffer);
+				GLState::Instance().UseProgram(m_copyShader);
+			}
+
+			m_copyRegion(methods[i], colorBuffer, screen); // warm up
+			glFinish();
+
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			for (int j = 0; j < iterations; j++)
+				m_copyRegion(methods[i], colorBuffer, screen);
+			glEndQuery(GL_TIME_ELAPSED);
+
+			GLuint64 time = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &time);
+
+			char line[64];
+			snprintf(line, 64, " %s %.3fms%s", names[i], time / 1000000.0 / iterations, methods[i] == best ? " (used)" : "");
+			report += line;
+		}
+
+		glDeleteQueries(1, &query);
+
+		if (!scissorEnabled)
+			GLState::Instance().Enable(GL_SCISSOR_TEST, false);
+		GLState::Instance().BindFramebuffer(GL_FRAMEBUFFER, curFBO);
+		GLState::Instance().Viewport(0, 0, m_rtw, m_rth);
+		GLState::Instance().Enable(GL_BLEND, true);
+
+		// first level now holds whatever was in the color buffer
+		InvalidateSnapshot(0);
+
+		host.Restore();
+
+		return report;
+	}
+	void ResourceManager::SetScreenTextureFormat(ScreenTextureFormat fmt)
+	{
+		if (m_format == fmt)
+			return;
+		m_format = fmt;
+
+		m_createComputeBlur();
+
+		// textures are created on the next resize if there aren't any yet
+		if (m_snapshots[0].Mipmaps.Pool.size() > 0) {
+			m_allocateMipmaps(m_poolWidth, m_poolHeight);
+			m_createMipmaps(m_rtw, m_rth);
+		}
+	}
+	void ResourceManager::SetExactScreenSize(bool exact)
+	{
+		if (m_exactScreenSize == exact)
+			return;
+		m_exactScreenSize = exact;
+
+		// going back to the pool keeps the current textures since they fit
+		if (m_snapshots[0].Mipmaps.Pool.size() > 0)
+			m_createMipmaps(m_rtw, m_rth);
+	}
+	std::string ResourceManager::BenchmarkScreenFormats(unsigned int colorBuffer, unsigned int curFBO, int iterations)
+	{
+		if (m_snapshots[0].Mipmaps.Sizes.size() == 0)
+			return "SCREEN_TEXTURE isn't created yet";
+
+		HostGLState host;
+		host.Save();
+
+		ScreenTextureFormat oldFormat = m_format;
+		ScreenTextureFormat formats[4] = { ScreenTextureFormat::RGBA8, ScreenTextureFormat::RGB10_A2, ScreenTextureFormat::R11F_G11F_B10F, ScreenTextureFormat::RGBA16F };
+		const char* names[4] = { "RGBA8", "RGB10_A2", "R11F_G11F_B10F", "RGBA16F" };
+
+		GLuint query;
+		glGenQueries(1, &query);
+
+		std::string report = "SCREEN_TEXTURE formats (" + std::to_string(m_rtw) + "x" + std::to_string(m_rth) + ", all levels, " + std::to_string(iterations) + " iterations):";
+		for (int i = 0; i < 4; i++) {
+			SetScreenTextureFormat(formats[i]);
+
+			// every level is written once & read once by the next level's blur
+			double bytes = 0.0;
+			for (const auto& size : m_snapshots[0].Mipmaps.Sizes)
+				bytes += 2.0 * size.Width * size.Height * getBytesPerPixel(m_format);
+
+			InvalidateSnapshot(0);
+			Copy(colorBuffer, curFBO); // warm up
+			glFinish();
+
+			glBeginQuery(GL_TIME_ELAPSED, query);
+			for (int j = 0; j < iterations; j++) {
+				InvalidateSnapshot(0);
+				Copy(colorBuffer, curFBO);
+			}
+			glEndQuery(GL_TIME_ELAPSED);
+
+			GLuint64 time = 0;
+			glGetQueryObjectui64v(query, GL_QUERY_RESULT, &time);
+			double ms = time / 1000000.0 / iterations;
+
+			char line[128];
+			snprintf(line, 128, " %s %.3fms ~%.1fMB (%.1fGB/s)", names[i], ms, bytes / 1000000.0, ms > 0.0 ? bytes / (ms * 1000000.0) : 0.0);
+			report += line;
+		}
+
+		glDeleteQueries(1, &query);
+
+		SetScreenTextureFormat(oldFormat);
+		InvalidateSnapshot(0);
+
+		host.Restore();
+
+		return report;
 	}
 	void ResourceManager::m_createEmptyTexture()
 	{
@@ -421,11 +1151,11 @@ void main()
 		}
 
 		glGenTextures(1, &EmptyTexture);
-		glBindTexture(GL_TEXTURE_2D, EmptyTexture);
+		GLState::Instance().SelectTexture(0, EmptyTexture);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, EMPTY_TEXTURE_SIZE, EMPTY_TEXTURE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pData);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::Instance().BindTexture(0, 0);
 
 		free(pData);
 	}
@@ -440,11 +1170,11 @@ void main()
 		pData[3] = 255;
 
 		glGenTextures(1, &BlackTexture);
-		glBindTexture(GL_TEXTURE_2D, BlackTexture);
+		GLState::Instance().SelectTexture(0, BlackTexture);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pData);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::Instance().BindTexture(0, 0);
 
 		free(pData);
 	}
@@ -459,11 +1189,11 @@ void main()
 		pData[3] = 255;
 
 		glGenTextures(1, &WhiteTexture);
-		glBindTexture(GL_TEXTURE_2D, WhiteTexture);
+		GLState::Instance().SelectTexture(0, WhiteTexture);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pData);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::Instance().BindTexture(0, 0);
 
 		free(pData);
 	}
@@ -0,0 +1,314 @@
+#include <Core/ShaderCache.h>
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <ctype.h>
+#include <stdint.h>
+#include <ghc/filesystem.hpp>
+
+#include <GL/glew.h>
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#define SHADER_CACHE_DIRECTORY ".gdshadercache"
+#define SHADER_CACHE_MAGIC 0x48534447 // "GDSH"
+#define SHADER_CACHE_VERSION 2
+
+namespace gd
+{
+	uint64_t hashFNV1a(const std::string& data, uint64_t hash = 14695981039346656037ULL)
+	{
+		for (unsigned char c : data) {
+			hash ^= c;
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	// binary stream helpers
+	template<typename T> void writeValue(std::ofstream& out, const T& val) { out.write((const char*)&val, sizeof(T)); }
+	template<typename T> bool readValue(std::ifstream& in, T& val) { return (bool)in.read((char*)&val, sizeof(T)); }
+	void writeString(std::ofstream& out, const std::string& str)
+	{
+		writeValue<uint32_t>(out, str.size());
+		out.write(str.data(), str.size());
+	}
+	bool readString(std::ifstream& in, std::string& str)
+	{
+		uint32_t len = 0;
+		if (!readValue(in, len))
+			return false;
+		str.resize(len);
+		return len == 0 || (bool)in.read(&str[0], len);
+	}
+
+	ShaderCache::ShaderCache()
+	{
+		m_driver = "";
+	}
+	ShaderCache::~ShaderCache()
+	{
+		for (auto& prog : m_programs)
+			prog.second->Shared = false; // let the materials release them
+		m_programs.clear();
+	}
+
+	bool ShaderCache::Load(const std::string& projectDir, const std::string& source, unsigned int variant, Entry& out)
+	{
+		out.Program = 0;
+
+		if (projectDir.empty())
+			return false;
+
+		std::ifstream in(m_getFilename(projectDir, source, variant), std::ios::binary);
+		if (!in.is_open())
+			return false;
+
+		// header -> everything has to match, otherwise do a full compile
+		uint32_t magic = 0, version = 0, storedVariant = 0;
+		std::string driver, storedSource;
+		if (!readValue(in, magic) || magic != SHADER_CACHE_MAGIC ||
+			!readValue(in, version) || version != SHADER_CACHE_VERSION ||
+			!readValue(in, storedVariant) || storedVariant != variant ||
+			!readString(in, driver) || driver != m_getDriverString() ||
+			!readString(in, storedSource) || storedSource != source)
+			return false;
+
+		// transcompiler output
+		GLSLOutput& data = out.Output;
+		uint32_t uniformCount = 0;
+		int32_t blendMode = 0;
+		uint8_t skipTransform = 0, screenTexture = 0, time = 0, instanced = 0;
+		if (!readString(in, data.Vertex) || !readString(in, data.Fragment) ||
+			!readString(in, out.Vertex) || !readString(in, out.Fragment) ||
+			!readValue(in, blendMode) || !readValue(in, skipTransform) || !readValue(in, screenTexture) ||
+			!readValue(in, time) || !readValue(in, instanced) || !readValue(in, uniformCount))
+			return false;
+
+		data.BlendMode = blendMode;
+		data.SkipVertexTransform = skipTransform;
+		data.SCREEN_TEXTURE = screenTexture;
+		data.TIME = time;
+		data.Error = false;
+		data.ErrorMessage = "";
+		data.ErrorLine = -1;
+		out.Instanced = instanced;
+
+		data.Uniforms.clear();
+		for (uint32_t i = 0; i < uniformCount; i++) {
+			std::string name;
+			int32_t order, textureOrder, type, precision, hint;
+			uint32_t valueCount;
+			if (!readString(in, name) || !readValue(in, order) || !readValue(in, textureOrder) ||
+				!readValue(in, type) || !readValue(in, precision) || !readValue(in, hint) || !readValue(in, valueCount))
+				return false;
+
+			ShaderLanguage::ShaderNode::Uniform& u = data.Uniforms[name];
+			u.order = order;
+			u.texture_order = textureOrder;
+			u.type = (ShaderLanguage::DataType)type;
+			u.precision = (ShaderLanguage::DataPrecision)precision;
+			u.hint = (ShaderLanguage::ShaderNode::Uniform::Hint)hint;
+			u.default_value.resize(valueCount);
+			for (uint32_t j = 0; j < valueCount; j++)
+				if (!readValue(in, u.default_value[j]))
+					return false;
+			for (int j = 0; j < 3; j++)
+				if (!readValue(in, u.hint_range[j]))
+					return false;
+		}
+
+		// program binary (optional)
+		uint32_t binaryFormat = 0, binarySize = 0;
+		if (readValue(in, binaryFormat) && readValue(in, binarySize) && binarySize > 0) {
+			std::vector<char> binary(binarySize);
+			if (in.read(binary.data(), binarySize)) {
+				GLuint program = glCreateProgram();
+				glProgramBinary(program, binaryFormat, binary.data(), binarySize);
+
+				GLint success = 0;
+				glGetProgramiv(program, GL_LINK_STATUS, &success);
+				if (success)
+					out.Program = program;
+				else
+					glDeleteProgram(program);
+			}
+		}
+
+		return true;
+	}
+	void ShaderCache::Save(const std::string& projectDir, const std::string& source, unsigned int variant, const Entry& entry)
+	{
+		if (projectDir.empty())
+			return;
+
+		std::error_code errc;
+		ghc::filesystem::create_directories(projectDir + "/" SHADER_CACHE_DIRECTORY, errc);
+
+		std::ofstream out(m_getFilename(projectDir, source, variant), std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return;
+
+		const GLSLOutput& data = entry.Output;
+
+		writeValue<uint32_t>(out, SHADER_CACHE_MAGIC);
+		writeValue<uint32_t>(out, SHADER_CACHE_VERSION);
+		writeValue<uint32_t>(out, variant);
+		writeString(out, m_getDriverString());
+		writeString(out, source);
+
+		writeString(out, data.Vertex);
+		writeString(out, data.Fragment);
+		writeString(out, entry.Vertex);
+		writeString(out, entry.Fragment);
+		writeValue<int32_t>(out, data.BlendMode);
+		writeValue<uint8_t>(out, data.SkipVertexTransform);
+		writeValue<uint8_t>(out, data.SCREEN_TEXTURE);
+		writeValue<uint8_t>(out, data.TIME);
+		writeValue<uint8_t>(out, entry.Instanced);
+
+		writeValue<uint32_t>(out, data.Uniforms.size());
+		for (const auto& uniform : data.Uniforms) {
+			const ShaderLanguage::ShaderNode::Uniform& u = uniform.second;
+			writeString(out, uniform.first);
+			writeValue<int32_t>(out, u.order);
+			writeValue<int32_t>(out, u.texture_order);
+			writeValue<int32_t>(out, u.type);
+			writeValue<int32_t>(out, u.precision);
+			writeValue<int32_t>(out, u.hint);
+			writeValue<uint32_t>(out, u.default_value.size());
+			for (const auto& val : u.default_value)
+				writeValue(out, val);
+			for (int j = 0; j < 3; j++)
+				writeValue(out, u.hint_range[j]);
+		}
+
+		// program binary
+		GLint binarySize = 0;
+		if (entry.Program != 0)
+			glGetProgramiv(entry.Program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+
+		std::vector<char> binary(binarySize);
+		GLenum binaryFormat = 0;
+		if (binarySize > 0)
+			glGetProgramBinary(entry.Program, binarySize, &binarySize, &binaryFormat, binary.data());
+
+		writeValue<uint32_t>(out, binaryFormat);
+		writeValue<uint32_t>(out, binarySize);
+		out.write(binary.data(), binarySize);
+	}
+
+	ShaderCache::Program* ShaderCache::Acquire(const std::string& source, unsigned int variant)
+	{
+		auto it = m_programs.find(m_getKey(source, variant));
+		if (it == m_programs.end() || it->second->Variant != variant || it->second->Source != source)
+			return nullptr;
+
+		it->second->References++;
+		return it->second;
+	}
+	ShaderCache::Program* ShaderCache::Create(const std::string& source, unsigned int variant, const Entry& entry, bool share)
+	{
+		Program* prog = new Program();
+		prog->Data = entry;
+		prog->Source = source;
+		prog->Variant = variant;
+		prog->Key = m_getKey(source, variant);
+		prog->References = 1;
+		prog->Shared = share && m_programs.count(prog->Key) == 0;
+		prog->LastUser = nullptr;
+
+		if (prog->Shared)
+			m_programs[prog->Key] = prog;
+
+		return prog;
+	}
+	void ShaderCache::Release(Program* prog)
+	{
+		prog->References--;
+		if (prog->References > 0)
+			return;
+
+		if (prog->Shared)
+			m_programs.erase(prog->Key);
+		if (prog->Data.Program != 0)
+			glDeleteProgram(prog->Data.Program);
+		delete prog;
+	}
+
+	uint64_t ShaderCache::GetTokenKey(const std::string& source, unsigned int variant)
+	{
+		uint64_t hash = 14695981039346656037ULL;
+		bool hasToken = false, space = false;
+		for (size_t i = 0; i < source.size(); i++) {
+			char c = source[i];
+
+			// comments, an unterminated block comment is kept since the transcompiler fails on it
+			if (c == '/' && i + 1 < source.size()) {
+				size_t end = std::string::npos;
+				if (source[i + 1] == '/')
+					end = std::min(source.find('\n', i), source.size());
+				else if (source[i + 1] == '*') {
+					end = source.find("*/", i + 2);
+					if (end != std::string::npos)
+						end++;
+				}
+
+				if (end != std::string::npos) {
+					i = end;
+					space = true;
+					continue;
+				}
+			}
+
+			// whitespace runs count as one separator
+			if (isspace((unsigned char)c)) {
+				space = true;
+				continue;
+			}
+
+			if (space && hasToken) {
+				hash ^= ' ';
+				hash *= 1099511628211ULL;
+			}
+			hash ^= (unsigned char)c;
+			hash *= 1099511628211ULL;
+
+			hasToken = true;
+			space = false;
+		}
+
+		return hashFNV1a(std::to_string(variant), hash);
+	}
+
+	uint64_t ShaderCache::m_getKey(const std::string& source, unsigned int variant)
+	{
+		uint64_t hash = hashFNV1a(source);
+		hash = hashFNV1a(m_getDriverString(), hash);
+		return hashFNV1a(std::to_string(variant), hash);
+	}
+	const std::string& ShaderCache::m_getDriverString()
+	{
+		if (m_driver.empty()) {
+			const char* vendor = (const char*)glGetString(GL_VENDOR);
+			const char* renderer = (const char*)glGetString(GL_RENDERER);
+			const char* version = (const char*)glGetString(GL_VERSION);
+
+			m_driver = std::string(vendor ? vendor : "") + "|" + (renderer ? renderer : "") + "|" + (version ? version : "");
+		}
+		return m_driver;
+	}
+	std::string ShaderCache::m_getFilename(const std::string& projectDir, const std::string& source, unsigned int variant)
+	{
+		uint64_t hash = m_getKey(source, variant);
+
+		char name[32];
+		snprintf(name, 32, "%016llx.bin", (unsigned long long)hash);
+
+		return projectDir + "/" SHADER_CACHE_DIRECTORY "/" + name;
+	}
+}
\ No newline at end of file
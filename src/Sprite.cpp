@@ -1,5 +1,8 @@
 #include <Core/Sprite.h>
+#include <Core/GLState.h>
+#include <Core/FrameStats.h>
 #include <Core/ResourceManager.h>
+#include <Core/TextureAtlas.h>
 #include <UI/UIHelper.h>
 
 #include <imgui/imgui.h>
@@ -149,13 +152,16 @@ namespace gd
 
 			printf("[GSHADERS] Setting texture to %s\n", texObjName.c_str());
 
+			// texture might have been reloaded -> update only its region in the atlas
+			TextureAtlas::Instance().Refresh(m_texID);
+
 			// get texture size
 			int w, h;
 			int miplevel = 0;
-			glBindTexture(GL_TEXTURE_2D, m_texID);
+			GLState::Instance().SelectTexture(0, m_texID);
 			glGetTexLevelParameteriv(GL_TEXTURE_2D, miplevel, GL_TEXTURE_WIDTH, &w);
 			glGetTexLevelParameteriv(GL_TEXTURE_2D, miplevel, GL_TEXTURE_HEIGHT, &h);
-			glBindTexture(GL_TEXTURE_2D, 0);
+			GLState::Instance().BindTexture(0, 0);
 
 			// recreate vbo
 			m_size = glm::vec2(w,h);
@@ -166,11 +172,10 @@ namespace gd
 			if (!m_visible)
 				return;
 
-			glActiveTexture(GL_TEXTURE0 + 0);
-			glBindTexture(GL_TEXTURE_2D, m_texID);
-
-			glBindVertexArray(m_vao);
+			GLState::Instance().BindTexture(0, m_texID);
+			GLState::Instance().BindVertexArray(m_vao);
 			glDrawArrays(GL_TRIANGLES, 0, 6);
+			FrameStats::Instance().Add(FrameCounter::DrawCalls);
 		}
 
 		void Sprite::m_buildVBO()
@@ -197,7 +202,7 @@ namespace gd
 			// create vao
 			if (m_vao == 0)
 				glGenVertexArrays(1, &m_vao);
-			glBindVertexArray(m_vao);
+			GLState::Instance().BindVertexArray(m_vao);
 
 			// create vbo
 			if (m_vbo == 0)
@@ -219,7 +224,7 @@ namespace gd
 			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(CanvasVertex), (void*)(2 * sizeof(GLfloat)));
 			glEnableVertexAttribArray(2);
 
-			glBindVertexArray(0);
+			GLState::Instance().BindVertexArray(0);
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 
 			m_buildMatrix();
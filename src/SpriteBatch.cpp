@@ -0,0 +1,124 @@
+#include <Core/SpriteBatch.h>
+#include <Core/TextureAtlas.h>
+#include <Core/GLState.h>
+#include <Core/FrameStats.h>
+
+#include <glm/glm.hpp>
+
+#include <GL/glew.h>
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#define SPRITE_BATCH_MIN_CAPACITY 6 * 256
+
+namespace gd
+{
+	SpriteBatch::SpriteBatch()
+	{
+		m_transform = true;
+		m_atlas = false;
+		m_vao = 0;
+		m_vbo = 0;
+		m_capacity = 0;
+	}
+	SpriteBatch::~SpriteBatch()
+	{
+
+	}
+
+	void SpriteBatch::Begin(bool transformVertices, bool useAtlas)
+	{
+		m_transform = transformVertices;
+		m_atlas = useAtlas;
+		m_verts.clear();
+		m_groups.clear();
+	}
+	void SpriteBatch::Add(pipe::Sprite* sprite)
+	{
+		if (!sprite->IsVisible())
+			return;
+
+		unsigned int tex = sprite->GetTextureID();
+		glm::vec4 uvRect(0.0f, 0.0f, 1.0f, 1.0f);
+		if (m_atlas)
+			tex = TextureAtlas::Instance().Map(tex, uvRect);
+
+		// start a new draw call only when the texture changes
+		if (m_groups.size() == 0 || m_groups.back().Texture != tex)
+			m_groups.push_back({ tex, (int)m_verts.size(), 0 });
+
+		const CanvasVertex* verts = sprite->GetVertices();
+		glm::mat4 matrix = sprite->GetMatrix();
+
+		for (int i = 0; i < 6; i++) {
+			CanvasVertex vert = verts[i];
+			vert.UV = glm::vec2(uvRect.x + vert.UV.x * uvRect.z, uvRect.y + vert.UV.y * uvRect.w);
+			if (m_transform) {
+				glm::vec4 pos = matrix * glm::vec4(vert.Position, 0.0f, 1.0f);
+				vert.Position = glm::vec2(pos.x, pos.y);
+			}
+			m_verts.push_back(vert);
+		}
+
+		m_groups.back().Count += 6;
+	}
+	void SpriteBatch::End()
+	{
+		if (m_verts.size() == 0)
+			return;
+
+		if (m_vao == 0)
+			m_createBuffers();
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+
+		// grow the buffer if needed and orphan the old storage so that we don't wait on the previous draw
+		while (m_capacity < m_verts.size())
+			m_capacity *= 2;
+		glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(CanvasVertex), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, m_verts.size() * sizeof(CanvasVertex), m_verts.data());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		// VAO stays bound, GodotShaders::EndRender unbinds it
+		GLState& state = GLState::Instance();
+		state.BindVertexArray(m_vao);
+		for (const auto& group : m_groups) {
+			state.BindTexture(0, group.Texture);
+			glDrawArrays(GL_TRIANGLES, group.First, group.Count);
+		}
+		FrameStats::Instance().Add(FrameCounter::DrawCalls, m_groups.size());
+	}
+
+	void SpriteBatch::m_createBuffers()
+	{
+		m_capacity = SPRITE_BATCH_MIN_CAPACITY;
+
+		// create vao
+		glGenVertexArrays(1, &m_vao);
+		GLState::Instance().BindVertexArray(m_vao);
+
+		// create vbo
+		glGenBuffers(1, &m_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(CanvasVertex), nullptr, GL_STREAM_DRAW);
+
+		// same layout as Sprite's VAO
+		// position
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(CanvasVertex), (void*)0);
+		glEnableVertexAttribArray(0);
+
+		// color
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(CanvasVertex), (void*)(4 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(1);
+
+		// uv
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(CanvasVertex), (void*)(2 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(2);
+
+		GLState::Instance().BindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+}
\ No newline at end of file
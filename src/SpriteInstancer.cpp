@@ -0,0 +1,208 @@
+#include <Core/SpriteInstancer.h>
+#include <Core/TextureAtlas.h>
+#include <Core/GLState.h>
+#include <Core/FrameStats.h>
+
+#include <regex>
+
+#include <GL/glew.h>
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#define SPRITE_INSTANCER_MIN_CAPACITY 256
+
+// declarations inserted right after the #version line
+const char* VS_INSTANCE_INPUTS = R"(
+layout(location = 0) in vec2 gd_quad_vertex;
+layout(location = 3) in vec4 gd_instance_rect;		// center.xy, size.xy
+layout(location = 4) in vec4 gd_instance_color;
+layout(location = 5) in vec2 gd_instance_params;	// rotation, flip flags
+layout(location = 6) in vec4 gd_instance_uv_rect;	// offset.xy, scale.xy
+)";
+
+// entry point appended to the shader, user's main() is renamed to gd_canvas_main()
+const char* VS_INSTANCE_MAIN = R"(
+void main()
+{
+	int flip = int(gd_instance_params.y);
+	vec2 uv = gd_quad_vertex + vec2(0.5);
+	if ((flip & 1) != 0) uv.x = 1.0 - uv.x;
+	if ((flip & 2) != 0) uv.y = 1.0 - uv.y;
+
+	float c = cos(gd_instance_params.x);
+	float s = sin(gd_instance_params.x);
+
+	vertex = gd_quad_vertex * gd_instance_rect.zw;
+	uv_attrib = gd_instance_uv_rect.xy + uv * gd_instance_uv_rect.zw;
+	color_attrib = gd_instance_color;
+	modelview_matrix = mat4(vec4(c, s, 0.0, 0.0), vec4(-s, c, 0.0, 0.0), vec4(0.0, 0.0, 1.0, 0.0), vec4(gd_instance_rect.xy, -1000.0, 1.0));
+
+	gd_canvas_main();
+}
+)";
+
+namespace gd
+{
+	SpriteInstancer::SpriteInstancer()
+	{
+		m_transform = true;
+		m_atlas = false;
+		m_vao = 0;
+		m_quadVBO = 0;
+		m_instanceVBO = 0;
+		m_capacity = 0;
+	}
+	SpriteInstancer::~SpriteInstancer()
+	{
+
+	}
+
+	void SpriteInstancer::Begin(bool transformVertices, bool useAtlas)
+	{
+		m_transform = transformVertices;
+		m_atlas = useAtlas;
+		m_instances.clear();
+		m_groups.clear();
+	}
+	void SpriteInstancer::Add(pipe::Sprite* sprite)
+	{
+		if (!sprite->IsVisible())
+			return;
+
+		SpriteInstance inst;
+		inst.UVRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+		unsigned int tex = sprite->GetTextureID();
+		if (m_atlas)
+			tex = TextureAtlas::Instance().Map(tex, inst.UVRect);
+
+		if (m_groups.size() == 0 || m_groups.back().Texture != tex)
+			m_groups.push_back({ tex, (int)m_instances.size(), 0 });
+
+		inst.Size = sprite->GetSize();
+		inst.Color = sprite->GetColor();
+		inst.Flip = (sprite->GetFlipHorizontal() ? 1.0f : 0.0f) + (sprite->GetFlipVertical() ? 2.0f : 0.0f);
+		if (m_transform) {
+			inst.Position = sprite->GetPosition() + inst.Size * 0.5f;
+			inst.Rotation = glm::radians(sprite->GetRotation());
+		} else {
+			inst.Position = glm::vec2(0.0f);
+			inst.Rotation = 0.0f;
+		}
+		m_instances.push_back(inst);
+
+		m_groups.back().Count++;
+	}
+	void SpriteInstancer::End()
+	{
+		if (m_instances.size() == 0)
+			return;
+
+		if (m_vao == 0)
+			m_createBuffers();
+
+		glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+		while (m_capacity < m_instances.size())
+			m_capacity *= 2;
+		glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, m_instances.size() * sizeof(SpriteInstance), m_instances.data());
+
+		// VAO stays bound, GodotShaders::EndRender unbinds it
+		GLState& state = GLState::Instance();
+		state.BindVertexArray(m_vao);
+		for (const auto& group : m_groups) {
+			m_setInstanceOffset(group.First);
+			state.BindTexture(0, group.Texture);
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 6, group.Count);
+		}
+		FrameStats::Instance().Add(FrameCounter::DrawCalls, m_groups.size());
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	std::string SpriteInstancer::CreateInstancedVertexShader(const std::string& vs)
+	{
+		static const std::regex versionRegex("#version[^\\n]*\\n");
+		static const std::regex inputRegex[] = {
+			std::regex("(layout\\s*\\([^)]*\\)\\s*)?in\\s+((highp|mediump|lowp)\\s+)?vec2\\s+vertex\\s*;"),
+			std::regex("(layout\\s*\\([^)]*\\)\\s*)?in\\s+((highp|mediump|lowp)\\s+)?vec4\\s+color_attrib\\s*;"),
+			std::regex("(layout\\s*\\([^)]*\\)\\s*)?in\\s+((highp|mediump|lowp)\\s+)?vec2\\s+uv_attrib\\s*;"),
+			std::regex("uniform\\s+((highp|mediump|lowp)\\s+)?mat4\\s+modelview_matrix\\s*;"),
+			std::regex("\\bvoid\\s+main\\s*\\(")
+		};
+		static const char* inputReplacement[] = {
+			"vec2 vertex;",
+			"vec4 color_attrib;",
+			"vec2 uv_attrib;",
+			"mat4 modelview_matrix;",
+			"void gd_canvas_main("
+		};
+
+		std::smatch versionMatch;
+		if (!std::regex_search(vs, versionMatch, versionRegex))
+			return "";
+
+		std::string ret = versionMatch.str() + VS_INSTANCE_INPUTS + std::string(versionMatch.suffix());
+		for (int i = 0; i < 5; i++) {
+			if (!std::regex_search(ret, inputRegex[i]))
+				return "";
+			ret = std::regex_replace(ret, inputRegex[i], inputReplacement[i], std::regex_constants::format_first_only);
+		}
+
+		return ret + VS_INSTANCE_MAIN;
+	}
+
+	void SpriteInstancer::m_createBuffers()
+	{
+		m_capacity = SPRITE_INSTANCER_MIN_CAPACITY;
+
+		// unit quad, same winding as Sprite's VBO
+		glm::vec2 quad[6] = {
+			{ -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f },
+			{ -0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f }
+		};
+
+		// create vao
+		glGenVertexArrays(1, &m_vao);
+		GLState::Instance().BindVertexArray(m_vao);
+
+		// quad vbo
+		glGenBuffers(1, &m_quadVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_quadVBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+		glEnableVertexAttribArray(0);
+
+		// instance vbo
+		glGenBuffers(1, &m_instanceVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+		for (int i = 3; i <= 6; i++) {
+			glEnableVertexAttribArray(i);
+			glVertexAttribDivisor(i, 1);
+		}
+		m_setInstanceOffset(0);
+
+		GLState::Instance().BindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	void SpriteInstancer::m_setInstanceOffset(int first)
+	{
+		// expects m_vao & m_instanceVBO to be bound
+		size_t base = first * sizeof(SpriteInstance);
+
+		// center & size
+		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base));
+
+		// color
+		glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + 4 * sizeof(GLfloat)));
+
+		// rotation & flip
+		glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + 8 * sizeof(GLfloat)));
+
+		// uv rectangle
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), (void*)(base + 10 * sizeof(GLfloat)));
+	}
+}
\ No newline at end of file
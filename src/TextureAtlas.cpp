@@ -0,0 +1,262 @@
+#include <Core/TextureAtlas.h>
+#include <Core/GLState.h>
+
+#include <GL/glew.h>
+#if defined(__APPLE__)
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#define ATLAS_PAGE_SIZE 2048
+#define ATLAS_MAX_PAGES 4
+#define ATLAS_MAX_TEXTURE_SIZE 1024
+#define ATLAS_PADDING 1 // on each side
+#define ATLAS_EVICT_FRAMES 120 // pages that weren't used for this long can be reused when the atlas is full
+
+namespace gd
+{
+	TextureAtlas::TextureAtlas()
+	{
+		m_readFBO = 0;
+		m_overflow = false;
+		m_frame = 0;
+	}
+	TextureAtlas::~TextureAtlas()
+	{
+
+	}
+
+	unsigned int TextureAtlas::Map(unsigned int tex, glm::vec4& uvRect)
+	{
+		uvRect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+		if (m_rejected.count(tex) || m_overflowed.count(tex))
+			return tex;
+
+		auto entryIt = m_entries.find(tex);
+		if (entryIt == m_entries.end()) {
+			// called while drawing -> unit 0 only, units 1+ hold SCREEN_TEXTURE & the samplers bound by CanvasMaterial::Bind
+			GLState& state = GLState::Instance();
+			unsigned int lastTex = state.GetTexture(0);
+
+			int w, h, format;
+			state.SelectTexture(0, tex);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+			glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+			state.BindTexture(0, lastTex);
+
+			bool supported = (format == GL_RGBA8 || format == GL_RGBA) && w > 0 && h > 0 &&
+				w <= ATLAS_MAX_TEXTURE_SIZE && h <= ATLAS_MAX_TEXTURE_SIZE;
+
+			if (!supported) {
+				m_rejected[tex] = true;
+				return tex;
+			}
+
+			Entry entry;
+			if (!m_allocate(w, h, entry)) {
+				m_overflowed[tex] = true;
+				return tex;
+			}
+
+			m_copy(tex, entry);
+			entryIt = m_entries.insert(std::make_pair(tex, entry)).first;
+		}
+
+		const Entry& entry = entryIt->second;
+		m_pages[entry.Page].LastUsed = m_frame;
+
+		// exact texel rectangle, the padding makes bilinear filtering at the edges match GL_CLAMP_TO_EDGE
+		uvRect.x = entry.X / (float)ATLAS_PAGE_SIZE;
+		uvRect.y = entry.Y / (float)ATLAS_PAGE_SIZE;
+		uvRect.z = entry.Width / (float)ATLAS_PAGE_SIZE;
+		uvRect.w = entry.Height / (float)ATLAS_PAGE_SIZE;
+
+		return m_pages[entry.Page].Texture;
+	}
+	void TextureAtlas::Refresh(unsigned int tex)
+	{
+		m_rejected.erase(tex);
+		m_overflowed.erase(tex);
+
+		auto entryIt = m_entries.find(tex);
+		if (entryIt == m_entries.end())
+			return;
+
+		GLState& state = GLState::Instance();
+		unsigned int lastTex = state.GetTexture(0);
+
+		int w, h;
+		state.SelectTexture(0, tex);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+		state.BindTexture(0, lastTex);
+
+		// same size -> overwrite in place, otherwise it will be packed again on the next Map() call
+		if (w == entryIt->second.Width && h == entryIt->second.Height)
+			m_copy(tex, entryIt->second);
+		else
+			m_entries.erase(entryIt);
+	}
+	void TextureAtlas::NewFrame()
+	{
+		m_frame++;
+
+		if (!m_overflow)
+			return;
+
+		// keep everything that is still in use, only reuse the pages that no sprite needed for a while
+		bool freed = false;
+		for (int i = 0; i < m_pages.size(); i++) {
+			if (m_frame - m_pages[i].LastUsed > ATLAS_EVICT_FRAMES) {
+				m_freePage(i);
+				freed = true;
+			}
+		}
+
+		// textures that didn't fit get another try
+		if (freed) {
+			m_overflowed.clear();
+			m_overflow = false;
+		}
+	}
+	void TextureAtlas::Clear()
+	{
+		for (auto& page : m_pages) {
+			glDeleteFramebuffers(1, &page.FBO);
+			glDeleteTextures(1, &page.Texture);
+		}
+		m_pages.clear();
+		m_entries.clear();
+		m_rejected.clear();
+		m_overflowed.clear();
+		m_overflow = false;
+	}
+
+	bool TextureAtlas::m_allocate(int w, int h, Entry& out)
+	{
+		for (int i = 0; i < m_pages.size(); i++)
+			if (m_allocateInPage(i, w, h, out))
+				return true;
+
+		// all pages are full -> draw it separately until NewFrame() frees a page
+		if (m_pages.size() >= ATLAS_MAX_PAGES) {
+			m_overflow = true;
+			return false;
+		}
+
+		m_createPage();
+		return m_allocateInPage(m_pages.size() - 1, w, h, out);
+	}
+	bool TextureAtlas::m_allocateInPage(int page, int w, int h, Entry& out)
+	{
+		Page& pg = m_pages[page];
+		int pw = w + 2 * ATLAS_PADDING;
+		int ph = h + 2 * ATLAS_PADDING;
+
+		// find the shelf that wastes the least amount of height
+		Shelf* best = nullptr;
+		for (auto& shelf : pg.Shelves)
+			if (shelf.Height >= ph && shelf.X + pw <= ATLAS_PAGE_SIZE)
+				if (best == nullptr || shelf.Height < best->Height)
+					best = &shelf;
+
+		// open a new shelf
+		if (best == nullptr) {
+			int y = pg.Shelves.size() == 0 ? 0 : (pg.Shelves.back().Y + pg.Shelves.back().Height);
+			if (y + ph > ATLAS_PAGE_SIZE || pw > ATLAS_PAGE_SIZE)
+				return false;
+
+			pg.Shelves.push_back({ y, ph, 0 });
+			best = &pg.Shelves.back();
+		}
+
+		out.Page = page;
+		out.X = best->X + ATLAS_PADDING;
+		out.Y = best->Y + ATLAS_PADDING;
+		out.Width = w;
+		out.Height = h;
+
+		best->X += pw;
+
+		return true;
+	}
+	void TextureAtlas::m_createPage()
+	{
+		Page page;
+		page.LastUsed = m_frame;
+
+		GLState& state = GLState::Instance();
+		unsigned int lastTex = state.GetTexture(0);
+
+		glGenTextures(1, &page.Texture);
+		state.SelectTexture(0, page.Texture);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		state.BindTexture(0, lastTex);
+
+		unsigned int lastFBO = state.GetFramebuffer(GL_DRAW_FRAMEBUFFER);
+
+		glGenFramebuffers(1, &page.FBO);
+		state.BindFramebuffer(GL_DRAW_FRAMEBUFFER, page.FBO);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, page.Texture, 0);
+
+		float zero[4] = { 0, 0, 0, 0 };
+		glClearBufferfv(GL_COLOR, 0, zero);
+
+		state.BindFramebuffer(GL_DRAW_FRAMEBUFFER, lastFBO);
+
+		m_pages.push_back(page);
+	}
+	void TextureAtlas::m_freePage(int page)
+	{
+		for (auto it = m_entries.begin(); it != m_entries.end();) {
+			if (it->second.Page == page)
+				it = m_entries.erase(it);
+			else
+				it++;
+		}
+
+		// the texture is kept, new entries overwrite the old texels
+		m_pages[page].Shelves.clear();
+		m_pages[page].LastUsed = m_frame;
+	}
+	void TextureAtlas::m_copy(unsigned int tex, const Entry& entry)
+	{
+		GLState& state = GLState::Instance();
+		unsigned int lastReadFBO = state.GetFramebuffer(GL_READ_FRAMEBUFFER);
+		unsigned int lastDrawFBO = state.GetFramebuffer(GL_DRAW_FRAMEBUFFER);
+
+		if (m_readFBO == 0)
+			glGenFramebuffers(1, &m_readFBO);
+
+		state.BindFramebuffer(GL_READ_FRAMEBUFFER, m_readFBO);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+		state.BindFramebuffer(GL_DRAW_FRAMEBUFFER, m_pages[entry.Page].FBO);
+
+		// texture + its edge texels stretched over the padding (left, right, bottom, top, then the corners)
+		int w = entry.Width, h = entry.Height, x = entry.X, y = entry.Y, p = ATLAS_PADDING;
+		const int blits[9][8] = {
+			{ 0, 0, w, h,			x, y, x + w, y + h },
+			{ 0, 0, 1, h,			x - p, y, x, y + h },
+			{ w - 1, 0, w, h,		x + w, y, x + w + p, y + h },
+			{ 0, 0, w, 1,			x, y - p, x + w, y },
+			{ 0, h - 1, w, h,		x, y + h, x + w, y + h + p },
+			{ 0, 0, 1, 1,			x - p, y - p, x, y },
+			{ w - 1, 0, w, 1,		x + w, y - p, x + w + p, y },
+			{ 0, h - 1, 1, h,		x - p, y + h, x, y + h + p },
+			{ w - 1, h - 1, w, h,	x + w, y + h, x + w + p, y + h + p }
+		};
+		for (const auto& b : blits)
+			glBlitFramebuffer(b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+		state.BindFramebuffer(GL_READ_FRAMEBUFFER, lastReadFBO);
+		state.BindFramebuffer(GL_DRAW_FRAMEBUFFER, lastDrawFBO);
+	}
+}
\ No newline at end of file
@@ -206,6 +206,9 @@ namespace gd
 			break;
 		}
 
+		if (ret)
+			u.Dirty = true;
+
 		return ret;
 	}
 